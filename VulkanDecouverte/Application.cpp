@@ -3,14 +3,28 @@
 #include <map>
 #include <set>
 
+#include "JobSystem.h"
+#include "LayoutCache.h"
+#include "PipelineCache.h"
+#include "UploadManager.h"
+
+#ifndef VD_HEADLESS_ONLY
 #include "RenderWindow.h"
+#endif
 
 Application::~Application()
 {
 
     // Cleanup
+    delete m_jobSystem;
+
     vkDeviceWaitIdle(getInstance()->getDevice());
 
+    delete m_pipelineCache;
+    delete m_layoutCache;
+    delete m_uploadManager;
+    delete m_allocator;
+
     vkDestroyDevice(m_device, nullptr);
 
     if (getInstance()->useValidationLayer()) {
@@ -19,11 +33,13 @@ Application::~Application()
     
     vkDestroyInstance(m_instance, nullptr);
 
-    glfwTerminate();
+#ifndef VD_HEADLESS_ONLY
+    if (!m_headless) glfwTerminate();
+#endif
     
 }
 
-void Application::Initialize(const char* appName)
+void Application::Initialize(const char* appName, bool headless)
 {
 
     static bool isInitialised = false;
@@ -31,7 +47,24 @@ void Application::Initialize(const char* appName)
     if (isInitialised) return;
     isInitialised = true;
 
-    glfwInit();
+    m_headless = headless;
+
+    // The thread calling Initialize becomes the main thread of the jobs
+    m_jobSystem = new JobSystem();
+
+    if (m_headless)
+    {
+        // Nothing will be presented, don't ask for the swapchain
+        m_deviceExtensions.clear();
+    }
+    else
+    {
+#ifdef VD_HEADLESS_ONLY
+        throw std::runtime_error("built without window support, only headless targets can run!");
+#else
+        glfwInit();
+#endif
+    }
     
     // MAY NOT BE IN THIS CLASS BUT IN A RENDER CONTEXT BECAUSE OF m_instance UNIQUE
     // Drivers informations
@@ -43,12 +76,6 @@ void Application::Initialize(const char* appName)
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.apiVersion = VK_API_VERSION_1_0;
 
-    // Get Render current platform
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions;
-
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
     VkInstanceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
     createInfo.pApplicationInfo = &appInfo;
@@ -80,6 +107,7 @@ void Application::Initialize(const char* appName)
 
 }
 
+#ifndef VD_HEADLESS_ONLY
 VkSurfaceKHR* Application::createSurface(RenderWindow& window)
 {
     VkSurfaceKHR* surface = new VkSurfaceKHR();
@@ -90,6 +118,7 @@ VkSurfaceKHR* Application::createSurface(RenderWindow& window)
     }
     return surface;
 }
+#endif
 
 void Application::setupDebugLayer()
 {
@@ -143,8 +172,10 @@ void Application::setupLogicalDevice(VkSurfaceKHR& surface)
     
     QueueFamilyIndices indices = findQueueFamilies(getPhysicalDevice(), surface);
 
+    m_queueFamilies = indices;
+
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+    std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value(), indices.transferFamily.value()};
 
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -156,8 +187,14 @@ void Application::setupLogicalDevice(VkSurfaceKHR& surface)
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    // The features and properties read while rating belong to the last device looked at
+    vkGetPhysicalDeviceFeatures(getPhysicalDevice(), &m_deviceFeatures);
+    vkGetPhysicalDeviceProperties(getPhysicalDevice(), &m_deviceProperties);
+
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    // Indirect draws of the GPU scene start anywhere in the visible objects
+    deviceFeatures.drawIndirectFirstInstance = m_deviceFeatures.drawIndirectFirstInstance;
     
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -183,6 +220,14 @@ void Application::setupLogicalDevice(VkSurfaceKHR& surface)
 
     vkGetDeviceQueue(m_device, indices.graphicsFamily.value(), 0, &m_graphicsQueue);
     vkGetDeviceQueue(m_device, indices.presentFamily.value(), 0, &m_presentQueue);
+    vkGetDeviceQueue(m_device, indices.transferFamily.value(), 0, &m_transferQueue);
+
+    m_allocator = new MemoryAllocator(m_device, getPhysicalDevice());
+    m_uploadManager = new UploadManager(m_device, indices.transferFamily.value(), m_transferQueue,
+        indices.graphicsFamily.value(), m_graphicsQueue);
+    // Loaded before any pipeline is built, so every one of them can come from the previous run
+    m_pipelineCache = new PipelineCache(m_device, m_deviceProperties);
+    m_layoutCache = new LayoutCache(m_device);
 }
 
 Application* Application::getInstance()
@@ -212,8 +257,9 @@ int Application::rateDeviceSuitability(VkPhysicalDevice device, VkSurfaceKHR& su
         score += 1000;
     }
 
-    bool swapChainAdequate = false;
-    if (extensionsSupported) {
+    // Headless devices are never asked for a swapchain
+    bool swapChainAdequate = surface == VK_NULL_HANDLE;
+    if (extensionsSupported && surface != VK_NULL_HANDLE) {
         SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device, surface);
         swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
     }
@@ -288,20 +334,44 @@ QueueFamilyIndices Application::findQueueFamilies(VkPhysicalDevice device, VkSur
 
     int i = 0;
     for (const auto& queueFamily : queueFamilies) {
-        if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+        if ((queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !graphicsFamily.graphicsFamily.has_value()) {
             graphicsFamily.graphicsFamily = i;
         }
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+        if (surface == VK_NULL_HANDLE)
+        {
+            // Nothing to present, any graphics family will do
+            presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+        }
+        else
+        {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+        }
 
-        if (presentSupport)
+        if (presentSupport && !graphicsFamily.presentFamily.has_value())
         {
             graphicsFamily.presentFamily = i;
         }
-        if (graphicsFamily.isComplete()) break;
+
+        // A family without graphics is driven by the copy engines, prefer the one without compute too
+        if ((queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT))
+        {
+            bool transferOnly = !(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT);
+            bool pickedTransferOnly = graphicsFamily.transferFamily.has_value()
+                && !(queueFamilies[graphicsFamily.transferFamily.value()].queueFlags & VK_QUEUE_COMPUTE_BIT);
+
+            if (!graphicsFamily.transferFamily.has_value() || (transferOnly && !pickedTransferOnly)) {
+                graphicsFamily.transferFamily = i;
+            }
+        }
         i++;
     }
 
+    // Graphics queues always support copies
+    if (!graphicsFamily.transferFamily.has_value()) {
+        graphicsFamily.transferFamily = graphicsFamily.graphicsFamily;
+    }
+
     return graphicsFamily;
     
 }
@@ -335,11 +405,18 @@ bool Application::checkValidationSupport()
 
 std::vector<const char*> Application::getRequiredExtensions() const
 {
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    std::vector<const char*> extensions;
 
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    // Get Render current platform
+#ifndef VD_HEADLESS_ONLY
+    if (!m_headless) {
+        uint32_t glfwExtensionCount = 0;
+        const char** glfwExtensions;
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
+#endif
 
     if (m_enableValidationLayers) {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -363,6 +440,11 @@ bool const& Application::useValidationLayer()
     return m_enableValidationLayers;
 }
 
+bool const& Application::isHeadless()
+{
+    return m_headless;
+}
+
 std::vector<const char*> const& Application::getDeviceExtensions()
 {
     return m_deviceExtensions;
@@ -383,6 +465,16 @@ VkQueue const& Application::getPresentQueue()
     return m_presentQueue;
 }
 
+VkQueue const& Application::getTransferQueue()
+{
+    return m_transferQueue;
+}
+
+QueueFamilyIndices const& Application::getQueueFamilies()
+{
+    return m_queueFamilies;
+}
+
 VkPhysicalDeviceProperties& Application::GetPhysicalDeviceProperties()
 {
     return m_deviceProperties;
@@ -431,7 +523,7 @@ uint32_t Application::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags
 }
 
 void Application::createBuffer(VkBufferUsageFlags usages, VkMemoryPropertyFlags flags,
-    VkBuffer& buffer, VkDeviceMemory& uploader, uint64_t size)
+    VkBuffer& buffer, Allocation& allocation, uint64_t size)
 {
     
     VkBufferCreateInfo bufferInfo{};
@@ -447,16 +539,80 @@ void Application::createBuffer(VkBufferUsageFlags usages, VkMemoryPropertyFlags
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(m_device, buffer, &memRequirements);
     
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, flags);
+    allocation = m_allocator->allocate(memRequirements, flags, MemoryAllocator::LINEAR);
 
-    if (vkAllocateMemory(m_device, &allocInfo, nullptr, &uploader) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate upload buffer memory!");
+    vkBindBufferMemory(m_device, buffer, allocation.memory, allocation.offset);
+}
+
+void Application::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
+    VkMemoryPropertyFlags properties, VkImage& image, Allocation& allocation)
+{
+    
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = width;
+    imageInfo.extent.height = height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = format;
+    imageInfo.tiling = tiling;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = usage;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateImage(m_device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create image!");
     }
 
-    vkBindBufferMemory(m_device, buffer, uploader, 0);
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(m_device, image, &memRequirements);
+
+    allocation = m_allocator->allocate(memRequirements, properties,
+        tiling == VK_IMAGE_TILING_OPTIMAL ? MemoryAllocator::OPTIMAL : MemoryAllocator::LINEAR);
+
+    vkBindImageMemory(m_device, image, allocation.memory, allocation.offset);
+}
+
+void Application::destroyBuffer(VkBuffer& buffer, Allocation& allocation)
+{
+    vkDestroyBuffer(m_device, buffer, nullptr);
+    m_allocator->free(allocation);
+    buffer = VK_NULL_HANDLE;
+}
+
+void Application::destroyImage(VkImage& image, Allocation& allocation)
+{
+    vkDestroyImage(m_device, image, nullptr);
+    m_allocator->free(allocation);
+    image = VK_NULL_HANDLE;
+}
+
+MemoryAllocator& Application::getAllocator()
+{
+    return *m_allocator;
+}
+
+UploadManager& Application::getUploadManager()
+{
+    return *m_uploadManager;
+}
+
+JobSystem& Application::getJobSystem()
+{
+    return *m_jobSystem;
+}
+
+VkPipelineCache Application::getPipelineCache()
+{
+    return m_pipelineCache->getHandle();
+}
+
+LayoutCache& Application::getLayoutCache()
+{
+    return *m_layoutCache;
 }
 
 VkResult Application::CreateDebugUtilsMessengerEXT(VkInstance instance,
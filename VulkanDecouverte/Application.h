@@ -2,11 +2,20 @@
 
 #include "framework.h"
 
+#include "MemoryAllocator.h"
+
+class JobSystem;
+class LayoutCache;
+class PipelineCache;
+class UploadManager;
+
 class RenderWindow;
 
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    // Dedicated copy family when the device has one, the graphics family otherwise
+    std::optional<uint32_t> transferFamily;
 
     bool isComplete() {
         return graphicsFamily.has_value() && presentFamily.has_value();
@@ -23,9 +32,11 @@ class Application
 {
 public:
     ~Application();
-    void Initialize(const char* appName);
+    void Initialize(const char* appName, bool headless = false);
 
+#ifndef VD_HEADLESS_ONLY
     VkSurfaceKHR* createSurface(RenderWindow& window);
+#endif
     void setupDebugLayer();
     void setupPhysicalDevice(VkSurfaceKHR& surface);
     void setupLogicalDevice(VkSurfaceKHR& surface);
@@ -37,21 +48,34 @@ public:
     VkPhysicalDevice const& getPhysicalDevice();
 
     bool const& useValidationLayer();
+    bool const& isHeadless();
     std::vector<const char*> const& getDeviceExtensions();
     std::vector<const char*> const& getValidationLayer();
 
     VkQueue const& getGraphicQueue();
     VkQueue const& getPresentQueue();
+    VkQueue const& getTransferQueue();
 
     VkPhysicalDeviceProperties& GetPhysicalDeviceProperties();
     VkPhysicalDeviceFeatures& GetPhysicalDeviceFeatures();
 
+    QueueFamilyIndices const& getQueueFamilies();
     QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR& surface);
     SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR& surface);
 
-    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
     void createBuffer(VkBufferUsageFlags usages, VkMemoryPropertyFlags flags,
-                      VkBuffer& buffer, VkDeviceMemory& uploader, uint64_t size);
+                      VkBuffer& buffer, Allocation& allocation, uint64_t size);
+    void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
+                     VkMemoryPropertyFlags properties, VkImage& image, Allocation& allocation);
+    void destroyBuffer(VkBuffer& buffer, Allocation& allocation);
+    void destroyImage(VkImage& image, Allocation& allocation);
+
+    MemoryAllocator& getAllocator();
+    UploadManager& getUploadManager();
+    JobSystem& getJobSystem();
+    // Shared by every pipeline, saved to disk when the application ends
+    VkPipelineCache getPipelineCache();
+    LayoutCache& getLayoutCache();
 
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
 
@@ -72,6 +96,18 @@ private:
     VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE; // Graphic Card Used
     VkQueue m_presentQueue = nullptr;
     VkQueue m_graphicsQueue = nullptr;
+    VkQueue m_transferQueue = nullptr;
+    QueueFamilyIndices m_queueFamilies;
+
+    // Every buffer and image memory comes from here
+    MemoryAllocator* m_allocator = nullptr;
+    // Staging ring, all mesh and texture data goes through it
+    UploadManager* m_uploadManager = nullptr;
+    // Workers shared by the whole engine, created by the thread that initializes the application
+    JobSystem* m_jobSystem = nullptr;
+    PipelineCache* m_pipelineCache = nullptr;
+    // Descriptor set and pipeline layouts, shared by the pipelines declaring the same resources
+    LayoutCache* m_layoutCache = nullptr;
 
     VkPhysicalDeviceProperties m_deviceProperties;
     VkPhysicalDeviceFeatures m_deviceFeatures;
@@ -84,6 +120,9 @@ private:
     bool m_enableValidationLayers = true;
 #endif
 
+    // Set when running without a window (benchmarks, build agents without a display)
+    bool m_headless = false;
+
     std::vector<const char*> m_deviceExtensions = {
     	VK_KHR_SWAPCHAIN_EXTENSION_NAME
     };
@@ -0,0 +1,161 @@
+#include "Frustum.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define FRUSTUM_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC compiles any intrinsic without an /arch switch
+#define TARGET_AVX
+#else
+#define TARGET_AVX __attribute__((target("avx")))
+#endif
+#endif
+
+void SphereList::set(size_t index, vec4 const& sphere)
+{
+    x[index] = sphere.x;
+    y[index] = sphere.y;
+    z[index] = sphere.z;
+    radius[index] = sphere.w;
+}
+
+void SphereList::resize(size_t size)
+{
+    x.resize(size);
+    y.resize(size);
+    z.resize(size);
+    radius.resize(size);
+}
+
+size_t SphereList::size() const
+{
+    return x.size();
+}
+
+Frustum Frustum::FromMatrix(mat4 const& viewProjection)
+{
+
+    // glm stores columns, the planes are built from the rows
+    mat4 rows = transpose(viewProjection);
+
+    Frustum frustum;
+    frustum.planes[0] = rows[3] + rows[0]; // Left
+    frustum.planes[1] = rows[3] - rows[0]; // Right
+    frustum.planes[2] = rows[3] + rows[1]; // Bottom, top once the projection flips y
+    frustum.planes[3] = rows[3] - rows[1];
+    frustum.planes[4] = rows[2];           // Near
+    frustum.planes[5] = rows[3] - rows[2]; // Far
+
+    // Normalized so the plane distance can be compared to a radius
+    for (vec4& plane : frustum.planes) {
+        plane /= length(vec3(plane));
+    }
+
+    return frustum;
+
+}
+
+bool Frustum::intersectsSphere(vec4 const& sphere) const
+{
+
+    for (vec4 const& plane : planes) {
+        if (dot(vec3(plane), vec3(sphere)) + plane.w < -sphere.w) return false;
+    }
+
+    return true;
+
+}
+
+#ifdef FRUSTUM_SIMD
+// The build targets SSE2 only, the AVX loop is compiled for AVX on its own and
+// picked at runtime, once, when the CPU and the OS both support it
+static bool HasAvx()
+{
+
+#ifdef _MSC_VER
+    int registers[4];
+    __cpuid(registers, 1);
+
+    // OSXSAVE and AVX, then the OS must save the YMM registers on context switch
+    bool osxsave = (registers[2] & (1 << 27)) != 0;
+    bool avx = (registers[2] & (1 << 28)) != 0;
+    return osxsave && avx && (_xgetbv(0) & 6) == 6;
+#else
+    return __builtin_cpu_supports("avx");
+#endif
+
+}
+
+static bool const CPU_HAS_AVX = HasAvx();
+
+// Tests 8 spheres per step from begin, returns the first sphere left untested
+TARGET_AVX static size_t cullSpheresAvx(vec4 const (&planes)[6], SphereList const& spheres, size_t begin, size_t end, uint8_t* visible)
+{
+
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(&spheres.x[i]);
+        __m256 y = _mm256_loadu_ps(&spheres.y[i]);
+        __m256 z = _mm256_loadu_ps(&spheres.z[i]);
+        __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&spheres.radius[i]));
+
+        __m256 inside = _mm256_cmp_ps(negativeRadius, negativeRadius, _CMP_EQ_OQ);
+        for (vec4 const& plane : planes)
+        {
+            __m256 distance = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(plane.x)), _mm256_mul_ps(y, _mm256_set1_ps(plane.y))),
+                _mm256_add_ps(_mm256_mul_ps(z, _mm256_set1_ps(plane.z)), _mm256_set1_ps(plane.w)));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+        }
+
+        int mask = _mm256_movemask_ps(inside);
+        for (int lane = 0; lane < 8; lane++) {
+            visible[i + lane] = (mask >> lane) & 1;
+        }
+    }
+
+    return i;
+
+}
+#endif
+
+void Frustum::cullSpheres(SphereList const& spheres, size_t begin, size_t end, uint8_t* visible) const
+{
+
+    size_t i = begin;
+
+#ifdef FRUSTUM_SIMD
+    if (CPU_HAS_AVX) {
+        i = cullSpheresAvx(planes, spheres, i, end, visible);
+    }
+
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(&spheres.x[i]);
+        __m128 y = _mm_loadu_ps(&spheres.y[i]);
+        __m128 z = _mm_loadu_ps(&spheres.z[i]);
+        __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.radius[i]));
+
+        __m128 inside = _mm_cmpeq_ps(negativeRadius, negativeRadius);
+        for (vec4 const& plane : planes)
+        {
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+                _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        for (int lane = 0; lane < 4; lane++) {
+            visible[i + lane] = (mask >> lane) & 1;
+        }
+    }
+#endif
+
+    for (; i < end; i++) {
+        visible[i] = intersectsSphere(vec4(spheres.x[i], spheres.y[i], spheres.z[i], spheres.radius[i])) ? 1 : 0;
+    }
+
+}
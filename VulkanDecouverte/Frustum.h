@@ -0,0 +1,31 @@
+#pragma once
+
+#include "framework.h"
+
+// Spheres with one array per component, the layout the SIMD test loads from
+struct SphereList
+{
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<float> radius;
+
+    void set(size_t index, vec4 const& sphere);
+    void resize(size_t size);
+    size_t size() const;
+};
+
+// Six planes facing inward, a point p is inside a plane when dot(plane.xyz, p) + plane.w >= 0
+struct Frustum
+{
+    vec4 planes[6];
+
+    // Planes of the clip volume of a Vulkan projection, depth going from 0 to 1
+    static Frustum FromMatrix(mat4 const& viewProjection);
+
+    // Sphere with its center in xyz and its radius in w
+    bool intersectsSphere(vec4 const& sphere) const;
+    // One flag per sphere of [begin, end), 1 when it touches the frustum. Tests 8 spheres
+    // per step with AVX when the CPU has it, 4 with SSE, the remainder one by one
+    void cullSpheres(SphereList const& spheres, size_t begin, size_t end, uint8_t* visible) const;
+};
@@ -1,24 +1,24 @@
 ﻿#include "GeometryFactory.h"
 
-#include <fstream>
-#include <sstream>
+#include <filesystem>
+
+#include "Application.h"
+#include "JobSystem.h"
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+#include "ObjParser.h"
 
 GeometryFactory::GeometryFactory()
 {
 	
-	mPrimitives.try_emplace(Primitive::CUBE, Primitive(CreateCube(1, 1, 1)));
-	mPrimitives.try_emplace(Primitive::PLANE, Primitive(CreatePlane(1, 1)));
+	mPrimitives.try_emplace(Primitive::CUBE, Primitive(CreatePrimitive(Primitive::CUBE)));
+	mPrimitives.try_emplace(Primitive::PLANE, Primitive(CreatePrimitive(Primitive::PLANE)));
 	
 }
 
 GeometryFactory::~GeometryFactory()
 {
 	
-	for (auto& meshPair : mLoadedMesh)
-	{
-		delete meshPair.second;
-	}
-
 	for (auto& primitivePair : mPrimitives)
 	{
 		delete primitivePair.second.Mesh;
@@ -32,110 +32,85 @@ GeometryFactory& GeometryFactory::getInstance()
 	return instance;
 }
 
-MeshData* GeometryFactory::LoadOrGetMeshFromFile(std::wstring path, bool invertV)
+MeshData* GeometryFactory::LoadMeshFromFile(std::wstring const& path, bool invertV)
 {
 
-	if (getInstance().mLoadedMesh.contains(path))
+	std::filesystem::path sourcePath = GEOMETRIES_FOLDER + path;
+	MeshData* data = nullptr;
+
+	if (sourcePath.extension() == MeshFile::EXTENSION)
 	{
-		return getInstance().mLoadedMesh.at(path);
+		data = MeshFile::Load(sourcePath);
+		if (data == nullptr)
+		{
+			std::cout << "Cannot load mesh " << sourcePath.string() << std::endl;
+			data = new MeshData();
+		}
 	}
-
-	MeshData* data = new MeshData();
-	
-	std::fstream meshFile;
-	meshFile.open(GEOMETRIES_FOLDER + path, std::ios::in);
-	
-	std::vector<vec2> tempTexCoords;
-	std::vector<vec3> tempPosition;
-	std::vector<vec3> tempNormal;
-	std::unordered_map<std::string, int> vertexCache;  // Maps "v/vt/vn" to a unique index
-
-	for(std::string line; std::getline(meshFile, line); )   // Read stream line by line
+	else
 	{
-	    std::istringstream in(line);      
-	    std::string type;
-	    in >> type;
-
-	    if(type == "v") 
-	    {
-	        float x, y, z;
-	        in >> x >> y >> z;
-	    	tempPosition.push_back({x,y,z});
-	    } 
-	    else if (type == "vn") 
-	    {
-	        float x, y, z;
-	        in >> x >> y >> z;
-	        tempNormal.push_back({x, y, z});
-	    } 
-	    else if (type == "vt") 
-	    { 
-	        float u, v;
-	        in >> u >> v;
-	        tempTexCoords.push_back( vec2(u, invertV ? 1 -v : v) ); // Flip V to match DirectX/OpenGL convention
-	    } 
-	    else if (type == "f") 
-	    {
-	        std::vector<int> faceIndices;
-	        std::string indicesString;
-
-	        while (in >> indicesString) 
-	        {
-	            std::istringstream indices(indicesString);
-	            std::string vIndex, vtIndex, vnIndex;
-	            int v = -1, vt = -1, vn = -1;
-
-	            std::getline(indices, vIndex, '/');  
-	            if (!vIndex.empty()) v = std::stoi(vIndex) - 1;
-
-	            if (std::getline(indices, vtIndex, '/')) 
-	                if (!vtIndex.empty()) vt = std::stoi(vtIndex) - 1;
-
-	            if (std::getline(indices, vnIndex, '/')) 
-	                if (!vnIndex.empty()) vn = std::stoi(vnIndex) - 1;
-
-	            // Create a unique key for this combination of v/vt/vn
-	            std::string key = vIndex + "/" + vtIndex + "/" + vnIndex;
-
-	            // Check if we've already created this vertex
-	            if (!vertexCache.contains(key)) 
-	            {
-	                Vertex newVertex; // Copy position
-	            	if (v != -1 && v < tempPosition.size()) newVertex.position = tempPosition[v];
-	            	if (vn != -1 && vn < tempNormal.size()) newVertex.normal = tempNormal[vn];
-	            	if (vt != -1 && vt < tempTexCoords.size()) newVertex.texCoords = tempTexCoords[vt];
-
-	                data->Vertices.push_back(newVertex);
-	                vertexCache[key] = data->Vertices.size() - 1;
-	            }
-
-	            // Store the correct index
-	            faceIndices.push_back(vertexCache[key]);
-	        }
-
-	        // Handle triangulation for quads
-	        if (faceIndices.size() == 3) {
-	            data->Indices.push_back(faceIndices[0]);
-	            data->Indices.push_back(faceIndices[1]);
-	            data->Indices.push_back(faceIndices[2]);
-	        } 
-	        else if (faceIndices.size() == 4) {
-	            // Convert quad to two triangles
-	            data->Indices.push_back(faceIndices[0]);
-	            data->Indices.push_back(faceIndices[1]);
-	            data->Indices.push_back(faceIndices[2]);
-
-	            data->Indices.push_back(faceIndices[0]);
-	            data->Indices.push_back(faceIndices[2]);
-	            data->Indices.push_back(faceIndices[3]);
-	        }
-	    }
+		std::filesystem::path binaryPath = ConvertedPath(path, invertV);
+		uint32_t flags = invertV ? MeshFileHeader::INVERTED_V : 0;
+
+		// Up to date when written after the model, a model missing from disk keeps its converted file
+		std::error_code sourceError, binaryError;
+		auto sourceTime = std::filesystem::last_write_time(sourcePath, sourceError);
+		auto binaryTime = std::filesystem::last_write_time(binaryPath, binaryError);
+		if (!binaryError && (sourceError || binaryTime >= sourceTime)) data = MeshFile::Load(binaryPath, flags);
+
+		if (data == nullptr)
+		{
+			data = ParseObj(path, invertV);
+			Optimize(*data, path);
+			if (!data->Vertices.empty() && !MeshFile::Write(binaryPath, *data, flags)) {
+				std::cout << "Cannot write " << binaryPath.string() << ", the model will be parsed again next time" << std::endl;
+			}
+		}
 	}
 
-
-	meshFile.close();
-	
 	return data;
+
+}
+
+bool GeometryFactory::ConvertObj(std::wstring path, bool invertV)
+{
+
+	std::filesystem::path binaryPath = ConvertedPath(path, invertV);
+
+	MeshData* data = ParseObj(path, invertV);
+	Optimize(*data, path);
+	bool written = !data->Vertices.empty() && MeshFile::Write(binaryPath, *data, invertV ? MeshFileHeader::INVERTED_V : 0);
+	delete data;
+
+	return written;
+
+}
+
+std::filesystem::path GeometryFactory::ConvertedPath(std::wstring const& path, bool invertV)
+{
+
+	std::filesystem::path binaryPath = GEOMETRIES_FOLDER + path;
+	binaryPath.replace_extension(invertV ? std::wstring(L".invertv") + MeshFile::EXTENSION : MeshFile::EXTENSION);
+	return binaryPath;
+
+}
+
+MeshData* GeometryFactory::ParseObj(std::wstring const& path, bool invertV)
+{
+	return ObjParser::Parse(GEOMETRIES_FOLDER + path, invertV, Application::getInstance()->getJobSystem());
+}
+
+void GeometryFactory::Optimize(MeshData& data, std::wstring const& path)
+{
+
+	MeshOptimizer::Stats before = MeshOptimizer::Analyze(data);
+	MeshOptimizer::Optimize(data);
+	MeshOptimizer::Stats after = MeshOptimizer::Analyze(data);
+
+	std::cout << "Optimized " << std::filesystem::path(path).string()
+		<< ": ACMR " << before.acmr << " -> " << after.acmr
+		<< ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+
 }
 
 MeshData* GeometryFactory::GetPrimitive(Primitive::Type primitiveType)
@@ -148,6 +123,22 @@ MeshData* GeometryFactory::GetPrimitive(Primitive::Type primitiveType)
 	return getInstance().mPrimitives.at(primitiveType).Mesh;
 }
 
+MeshData* GeometryFactory::CreatePrimitive(Primitive::Type primitiveType)
+{
+
+	switch (primitiveType)
+	{
+	case Primitive::CUBE:
+		return CreateCube(1, 1, 1);
+	case Primitive::PLANE:
+		return CreatePlane(1, 1);
+	default:
+		std::cout << "Primitive " << primitiveType << " not found" << std::endl;
+		return new MeshData();
+	}
+
+}
+
 MeshData* GeometryFactory::CreateCube(float width, float height, float depth)
 {
 	MeshData* meshData = new MeshData();
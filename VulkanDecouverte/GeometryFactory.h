@@ -1,4 +1,6 @@
 ﻿#pragma once
+#include <filesystem>
+#include <map>
 #include <string>
 
 #include "Mesh.h"
@@ -27,16 +29,30 @@ public:
     static GeometryFactory& getInstance();
 
     [[nodiscard]] static MeshData* GetPrimitive(Primitive::Type);
+    // Owned by the caller, MeshCache::loadPrimitive shares one per context
+    [[nodiscard]] static MeshData* CreatePrimitive(Primitive::Type);
     
-    [[nodiscard]] static MeshData* LoadOrGetMeshFromFile(std::wstring path, bool invertV);
+    // Meshes of the models are shared through MeshCache, the factory only reads them
+    // A .vmesh file is loaded as is. An OBJ model goes through the .vmesh next to it,
+    // converted on the first load and again whenever the model is newer. The flipped
+    // variant has its own file, model.invertv.vmesh.
+    // Owned by the caller, never null, empty when the file cannot be read. Safe from any thread
+    [[nodiscard]] static MeshData* LoadMeshFromFile(std::wstring const& path, bool invertV);
+    // Write the .vmesh of an OBJ model ahead of time, false when it cannot be written
+    static bool ConvertObj(std::wstring path, bool invertV);
     [[nodiscard]] static MeshData* CreateCube(float width, float height, float depth);
     [[nodiscard]] static MeshData* CreatePlane(float width, float height);
 
-    static const inline wstring GEOMETRIES_FOLDER = L"res\\models\\";
+    static const inline wstring GEOMETRIES_FOLDER = L"res/models/";
 
 private :
 
-    std::map<wstring, MeshData*> mLoadedMesh = {};
+    static MeshData* ParseObj(std::wstring const& path, bool invertV);
+    // Both orientations of a model can be cached at once, they never share a converted file
+    static std::filesystem::path ConvertedPath(std::wstring const& path, bool invertV);
+    // Once per import, the converted file keeps the result. Logs the cache ratios before and after
+    static void Optimize(MeshData& data, std::wstring const& path);
+
     std::map<int8, Primitive> mPrimitives = {};
 
 };
@@ -0,0 +1,201 @@
+#include "GpuProfiler.h"
+
+#include "Application.h"
+#include "UploadManager.h"
+
+GpuProfiler::Scope::Scope(GpuProfiler& profiler, VkCommandBuffer commandBuffer, const char* name)
+    : m_profiler(profiler), m_commandBuffer(commandBuffer)
+{
+    m_index = m_profiler.beginScope(m_commandBuffer, name);
+}
+
+GpuProfiler::Scope::~Scope()
+{
+    m_profiler.endScope(m_commandBuffer, m_index);
+}
+
+GpuProfiler::GpuProfiler(uint32_t framesInFlight, uint32_t maxScopes)
+    : m_device(&Application::getInstance()->getDevice()), m_maxScopes(maxScopes)
+{
+
+    m_frames.resize(framesInFlight);
+
+    // Timestamps are optional, without them only the CPU side is reported
+    VkPhysicalDeviceLimits const& limits = Application::getInstance()->GetPhysicalDeviceProperties().limits;
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(Application::getInstance()->getPhysicalDevice(), &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(Application::getInstance()->getPhysicalDevice(), &queueFamilyCount, queueFamilies.data());
+
+    uint32_t validBits = queueFamilies[Application::getInstance()->getQueueFamilies().graphicsFamily.value()].timestampValidBits;
+
+    m_supported = limits.timestampComputeAndGraphics && validBits > 0;
+    if (!m_supported) return;
+
+    m_timestampPeriod = limits.timestampPeriod;
+    m_timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+    for (FrameQueries& frame : m_frames) {
+        frame.pool = createPool(m_maxScopes * 2);
+        frame.scopes.reserve(m_maxScopes);
+    }
+
+}
+
+GpuProfiler::~GpuProfiler()
+{
+
+    for (FrameQueries& frame : m_frames) {
+        if (frame.pool != VK_NULL_HANDLE) vkDestroyQueryPool(*m_device, frame.pool, nullptr);
+    }
+
+}
+
+bool GpuProfiler::isSupported() const
+{
+    return m_supported;
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frame)
+{
+
+    m_currentFrame = frame;
+    m_depth = 0;
+
+    FrameQueries& queries = m_frames[frame];
+    queries.scopes.clear();
+    queries.recorded = m_supported;
+    queries.cpuStart = Clock::now();
+
+    if (m_supported) {
+        vkCmdResetQueryPool(commandBuffer, queries.pool, 0, m_maxScopes * 2);
+    }
+
+}
+
+void GpuProfiler::endFrame()
+{
+    FrameQueries& queries = m_frames[m_currentFrame];
+    queries.cpuFrameTime = std::chrono::duration<double, std::milli>(Clock::now() - queries.cpuStart).count();
+}
+
+uint32_t GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const char* name)
+{
+
+    FrameQueries& queries = m_frames[m_currentFrame];
+    if (queries.scopes.size() >= m_maxScopes) return UINT32_MAX;
+
+    uint32_t index = static_cast<uint32_t>(queries.scopes.size());
+    queries.scopes.push_back({ name, m_depth++, Clock::now(), 0.0 });
+
+    if (m_supported) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queries.pool, index * 2);
+    }
+
+    return index;
+
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t scope)
+{
+
+    if (scope == UINT32_MAX) return;
+
+    FrameQueries& queries = m_frames[m_currentFrame];
+    PendingScope& pending = queries.scopes[scope];
+    pending.cpuTime = std::chrono::duration<double, std::milli>(Clock::now() - pending.cpuStart).count();
+    m_depth--;
+
+    if (m_supported) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queries.pool, scope * 2 + 1);
+    }
+
+}
+
+bool GpuProfiler::collect(uint32_t frame)
+{
+
+    FrameQueries& queries = m_frames[frame];
+    if (queries.scopes.empty()) return false;
+
+    uint32_t queryCount = static_cast<uint32_t>(queries.scopes.size()) * 2;
+    std::vector<uint64_t> timestamps(queryCount, 0);
+
+    if (queries.recorded) {
+        VkResult result = vkGetQueryPoolResults(*m_device, queries.pool, 0, queryCount,
+            timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+        if (result != VK_SUCCESS) return false;
+    }
+
+    m_results.clear();
+    m_cpuFrameTime = queries.cpuFrameTime;
+    m_gpuFrameTime = 0.0;
+
+    uint64_t frameBegin = UINT64_MAX;
+    uint64_t frameEnd = 0;
+
+    for (size_t i = 0; i < queries.scopes.size(); i++)
+    {
+        PendingScope const& pending = queries.scopes[i];
+        uint64_t begin = timestamps[i * 2];
+        uint64_t end = timestamps[i * 2 + 1];
+
+        m_results.push_back({ pending.name, pending.depth, pending.cpuTime, queries.recorded ? toMilliseconds(begin, end) : 0.0 });
+
+        frameBegin = std::min(frameBegin, begin);
+        frameEnd = std::max(frameEnd, end);
+    }
+
+    if (queries.recorded) {
+        m_gpuFrameTime = toMilliseconds(frameBegin, frameEnd);
+    }
+
+    UploadManager::Timings uploads = Application::getInstance()->getUploadManager().takeTimings();
+    if (uploads.batchCount > 0) {
+        m_results.push_back({ "Uploads (" + std::to_string(uploads.batchCount) + ")", 0, uploads.cpuTime, uploads.gpuTime });
+    }
+
+    queries.scopes.clear();
+
+    return queries.recorded;
+
+}
+
+std::vector<GpuProfiler::ScopeResult> const& GpuProfiler::getResults() const
+{
+    return m_results;
+}
+
+double GpuProfiler::getCpuFrameTime() const
+{
+    return m_cpuFrameTime;
+}
+
+double GpuProfiler::getGpuFrameTime() const
+{
+    return m_gpuFrameTime;
+}
+
+VkQueryPool GpuProfiler::createPool(uint32_t queryCount)
+{
+
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = queryCount;
+
+    VkQueryPool pool;
+    if (vkCreateQueryPool(*m_device, &queryPoolInfo, nullptr, &pool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create timestamp query pool!");
+    }
+
+    return pool;
+
+}
+
+double GpuProfiler::toMilliseconds(uint64_t begin, uint64_t end) const
+{
+    return (double)((end - begin) & m_timestampMask) * m_timestampPeriod / 1000000.0;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+#include "framework.h"
+
+// GPU side of the profiler: timestamp queries written around named scopes of the
+// frame command buffers. Every frame in flight owns its query pool and the results
+// are read once the frame fence has signaled, so reading them never stalls the CPU.
+class GpuProfiler
+{
+public:
+    struct ScopeResult
+    {
+        std::string name;
+        uint32_t depth;
+        double cpuTime; // ms the CPU spent recording the scope
+        double gpuTime; // ms the GPU spent executing it
+    };
+
+    // Times everything recorded in the command buffer during its lifetime
+    class Scope
+    {
+    public:
+        Scope(GpuProfiler& profiler, VkCommandBuffer commandBuffer, const char* name);
+        ~Scope();
+
+    private:
+        GpuProfiler& m_profiler;
+        VkCommandBuffer m_commandBuffer;
+        uint32_t m_index;
+    };
+
+    GpuProfiler(uint32_t framesInFlight, uint32_t maxScopes = 64);
+    ~GpuProfiler();
+
+    bool isSupported() const;
+
+    // Reset the queries of the frame slot, must be recorded outside of a render pass
+    void beginFrame(VkCommandBuffer commandBuffer, uint32_t frame);
+    void endFrame();
+    uint32_t beginScope(VkCommandBuffer commandBuffer, const char* name);
+    void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+    // Read the results of the frame slot, its fence must have signaled. The upload
+    // batches finished since the last call are added as an "Uploads" entry
+    bool collect(uint32_t frame);
+
+    std::vector<ScopeResult> const& getResults() const;
+    // CPU time is measured from beginFrame to endFrame, the recording of the frame
+    double getCpuFrameTime() const;
+    double getGpuFrameTime() const;
+
+private:
+    using Clock = std::chrono::high_resolution_clock;
+
+    struct PendingScope
+    {
+        std::string name;
+        uint32_t depth;
+        Clock::time_point cpuStart;
+        double cpuTime;
+    };
+
+    struct FrameQueries
+    {
+        VkQueryPool pool = VK_NULL_HANDLE;
+        std::vector<PendingScope> scopes;
+        Clock::time_point cpuStart;
+        double cpuFrameTime = 0.0;
+        bool recorded = false;
+    };
+
+    VkDevice const* m_device;
+
+    bool m_supported = false;
+    double m_timestampPeriod = 0.0;
+    uint64_t m_timestampMask = ~0ull;
+    uint32_t m_maxScopes;
+
+    std::vector<FrameQueries> m_frames;
+    uint32_t m_currentFrame = 0;
+    uint32_t m_depth = 0;
+
+    std::vector<ScopeResult> m_results;
+    double m_cpuFrameTime = 0.0;
+    double m_gpuFrameTime = 0.0;
+
+    VkQueryPool createPool(uint32_t queryCount);
+    double toMilliseconds(uint64_t begin, uint64_t end) const;
+
+};
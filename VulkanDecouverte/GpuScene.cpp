@@ -0,0 +1,296 @@
+#include "GpuScene.h"
+
+#include <algorithm>
+
+#include "Frustum.h"
+#include "LayoutCache.h"
+#include "Mesh.h"
+#include "Profiler.h"
+#include "RenderContext.h"
+#include "RenderPipeline.h"
+#include "Shader.h"
+
+static constexpr uint32_t CULL_GROUP_SIZE = 64;
+
+GpuScene::GpuScene(RenderContext& context, uint32_t capacity)
+    : m_context(&context), m_device(&Application::getInstance()->getDevice())
+{
+
+    // The commands start their instances anywhere in the visible buffer
+    if (!Application::getInstance()->GetPhysicalDeviceFeatures().drawIndirectFirstInstance) {
+        throw std::runtime_error("failed to create GPU scene, drawIndirectFirstInstance is not supported!");
+    }
+
+    // The visible buffer is bound whole
+    uint32_t maxRange = Application::getInstance()->GetPhysicalDeviceProperties().limits.maxStorageBufferRange;
+    m_capacity = std::min<uint32_t>(capacity, maxRange / sizeof(ObjectData));
+    m_objects.reserve(m_capacity);
+
+    createCullPipeline();
+    createFrameResources();
+
+}
+
+GpuScene::~GpuScene()
+{
+
+    // The draw descriptor sets go away with the pool of the context
+    for (FrameResources& resources : m_frames) {
+        Application::getInstance()->destroyBuffer(resources.objectBuffer, resources.objectMemory);
+        Application::getInstance()->destroyBuffer(resources.commandBuffer, resources.commandMemory);
+        Application::getInstance()->destroyBuffer(resources.visibleBuffer, resources.visibleMemory);
+    }
+
+    vkDestroyPipeline(*m_device, m_cullPipeline, nullptr);
+    vkDestroyDescriptorPool(*m_device, m_cullDescriptorPool, nullptr);
+
+}
+
+void GpuScene::createCullPipeline()
+{
+
+    Shader sCompute("cull.comp", Shader::COMPUTE);
+
+    // Objects, commands and visible objects, then the planes and the object count pushed each frame
+    LayoutCache& layouts = Application::getInstance()->getLayoutCache();
+    m_cullDescriptorSetLayout = layouts.getDescriptorSetLayout(sCompute.getReflection().getSetBindings(0));
+    m_cullPipelineLayout = layouts.getPipelineLayout(sCompute.getReflection());
+
+    uint32_t setCount = static_cast<uint32_t>(m_context->MAX_FRAMES_IN_FLIGHT);
+
+    VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, setCount * 3 };
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = setCount;
+
+    if (vkCreateDescriptorPool(*m_device, &poolInfo, nullptr, &m_cullDescriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create culling descriptor pool!");
+    }
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = sCompute.getShaderInformation();
+    pipelineInfo.layout = m_cullPipelineLayout;
+
+    if (vkCreateComputePipelines(*m_device, Application::getInstance()->getPipelineCache(), 1, &pipelineInfo, nullptr, &m_cullPipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create culling pipeline!");
+    }
+
+}
+
+void GpuScene::createFrameResources()
+{
+
+    m_frames.resize(m_context->MAX_FRAMES_IN_FLIGHT);
+
+    for (uint32_t frame = 0; frame < m_frames.size(); frame++)
+    {
+        FrameResources& resources = m_frames[frame];
+        resources.dirtyBegin = 0;
+        resources.dirtyEnd = 0;
+
+        Application::getInstance()->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            resources.objectBuffer, resources.objectMemory, m_capacity * sizeof(ObjectData));
+
+        Application::getInstance()->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            resources.commandBuffer, resources.commandMemory, MAX_MESHES * sizeof(VkDrawIndexedIndirectCommand));
+
+        Application::getInstance()->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            resources.visibleBuffer, resources.visibleMemory, m_capacity * sizeof(mat4));
+
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = m_cullDescriptorPool;
+        allocInfo.pSetLayouts = &m_cullDescriptorSetLayout;
+        allocInfo.descriptorSetCount = 1;
+
+        if (vkAllocateDescriptorSets(*m_device, &allocInfo, &resources.cullDescriptorSet) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate culling descriptor sets!");
+        }
+
+        std::array<VkDescriptorBufferInfo, 3> bufferInfos = {{
+            { resources.objectBuffer, 0, VK_WHOLE_SIZE },
+            { resources.commandBuffer, 0, VK_WHOLE_SIZE },
+            { resources.visibleBuffer, 0, VK_WHOLE_SIZE },
+        }};
+
+        std::array<VkWriteDescriptorSet, 3> writeDescriptorSets{};
+        for (uint32_t binding = 0; binding < writeDescriptorSets.size(); binding++) {
+            writeDescriptorSets[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writeDescriptorSets[binding].dstSet = resources.cullDescriptorSet;
+            writeDescriptorSets[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            writeDescriptorSets[binding].dstBinding = binding;
+            writeDescriptorSets[binding].pBufferInfo = &bufferInfos[binding];
+            writeDescriptorSets[binding].descriptorCount = 1;
+        }
+
+        vkUpdateDescriptorSets(*m_device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+
+        // Same layout as the object pages, so the usual pipelines draw the visible objects
+        resources.drawDescriptorSet = m_context->createObjectDescriptorSet(frame, resources.visibleBuffer);
+    }
+
+}
+
+uint32_t GpuScene::addObject(Mesh const& mesh, mat4 const& transform)
+{
+
+    if (m_objects.size() == m_capacity) {
+        throw std::runtime_error("too many objects in the GPU scene!");
+    }
+
+    auto batch = m_batchIndices.find(&mesh);
+    if (batch == m_batchIndices.end())
+    {
+        if (m_batches.size() == MAX_MESHES) {
+            throw std::runtime_error("too many meshes in the GPU scene!");
+        }
+
+        batch = m_batchIndices.emplace(&mesh, static_cast<uint32_t>(m_batches.size())).first;
+        m_batches.push_back({ &mesh, 0 });
+    }
+    m_batches[batch->second].objectCount++;
+
+    ObjectData object{};
+    object.model = transform;
+    object.sphere = mesh.getBoundingSphere();
+    object.command = batch->second;
+    m_objects.push_back(object);
+
+    uint32_t index = static_cast<uint32_t>(m_objects.size() - 1);
+    markDirty(index);
+
+    return index;
+
+}
+
+void GpuScene::setTransform(uint32_t object, mat4 const& transform)
+{
+    m_objects[object].model = transform;
+    markDirty(object);
+}
+
+void GpuScene::markDirty(uint32_t object)
+{
+
+    // Every frame slot has its own copy, each one catches up before its next culling
+    for (FrameResources& resources : m_frames)
+    {
+        if (resources.dirtyBegin == resources.dirtyEnd) {
+            resources.dirtyBegin = object;
+            resources.dirtyEnd = object + 1;
+        } else {
+            resources.dirtyBegin = std::min(resources.dirtyBegin, object);
+            resources.dirtyEnd = std::max(resources.dirtyEnd, object + 1);
+        }
+    }
+
+}
+
+uint32_t GpuScene::getObjectCount() const
+{
+    return static_cast<uint32_t>(m_objects.size());
+}
+
+uint32_t GpuScene::getCapacity() const
+{
+    return m_capacity;
+}
+
+void GpuScene::cull(VkCommandBuffer commandBuffer, uint32_t frame, Frustum const& frustum)
+{
+
+    PROFILE_FUNCTION();
+
+    FrameResources& resources = m_frames[frame];
+
+    // The fence of the slot was waited, the GPU is done with these buffers
+    if (resources.dirtyBegin < resources.dirtyEnd)
+    {
+        ObjectData* objects = static_cast<ObjectData*>(resources.objectMemory.mapped);
+        std::copy(m_objects.begin() + resources.dirtyBegin, m_objects.begin() + resources.dirtyEnd, objects + resources.dirtyBegin);
+
+        resources.dirtyBegin = 0;
+        resources.dirtyEnd = 0;
+    }
+
+    // Each batch owns a range of the visible buffer as large as its object count
+    VkDrawIndexedIndirectCommand* commands = static_cast<VkDrawIndexedIndirectCommand*>(resources.commandMemory.mapped);
+    uint32_t firstInstance = 0;
+    for (size_t i = 0; i < m_batches.size(); i++)
+    {
+        commands[i].indexCount = m_batches[i].mesh->getIndexCount();
+        commands[i].instanceCount = 0;
+        commands[i].firstIndex = 0;
+        commands[i].vertexOffset = 0;
+        commands[i].firstInstance = firstInstance;
+        firstInstance += m_batches[i].objectCount;
+    }
+
+    if (m_objects.empty()) return;
+
+    CullConstants constants{};
+    std::copy(std::begin(frustum.planes), std::end(frustum.planes), constants.planes);
+    constants.objectCount = static_cast<uint32_t>(m_objects.size());
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipelineLayout,
+        0, 1, &resources.cullDescriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, m_cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+        0, offsetof(CullConstants, objectCount) + sizeof(uint32_t), &constants);
+
+    vkCmdDispatch(commandBuffer, (constants.objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+    // Instance counts are read as draw parameters, the matrices by the vertex shader
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+}
+
+uint32_t GpuScene::draw(VkCommandBuffer commandBuffer, uint32_t frame, RenderPipeline& pipeline)
+{
+
+    PROFILE_FUNCTION();
+
+    FrameResources& resources = m_frames[frame];
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.getGraphicsPipeline());
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.getPipelineLayout(),
+        0, 1, &resources.drawDescriptorSet, 0, nullptr);
+
+    // Every mesh has its own vertex and index buffers, so one indirect draw per mesh.
+    // A mesh with nothing visible costs a draw with zero instances, no CPU work per object
+    uint32_t drawCount = 0;
+    for (size_t i = 0; i < m_batches.size(); i++)
+    {
+        Mesh const* mesh = m_batches[i].mesh;
+
+        VkBuffer vertexBuffers[] = {
+            mesh->getVertexBuffer()
+        };
+
+        VkDeviceSize offsets[] = {0};
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+        vkCmdBindIndexBuffer(commandBuffer, mesh->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+
+        vkCmdDrawIndexedIndirect(commandBuffer, resources.commandBuffer,
+            i * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+        drawCount++;
+    }
+
+    return drawCount;
+
+}
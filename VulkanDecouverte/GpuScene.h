@@ -0,0 +1,99 @@
+#pragma once
+
+#include <unordered_map>
+
+#include "framework.h"
+
+#include "MemoryAllocator.h"
+
+class Mesh;
+class RenderContext;
+class RenderPipeline;
+struct Frustum;
+
+// Objects living on the GPU between frames, culled by a compute pass and drawn
+// with one indirect draw per mesh. Recording a frame costs the same for ten
+// objects or a hundred thousand, only the changed transforms are copied.
+class GpuScene
+{
+
+    // Matches ObjectData in cull.comp
+    struct ObjectData {
+        mat4 model;
+        vec4 sphere;
+        uint32_t command;
+        uint32_t padding[3];
+    };
+
+    // Matches the Culling push constants in cull.comp
+    struct CullConstants {
+        vec4 planes[6];
+        uint32_t objectCount;
+    };
+
+    // Objects sharing a mesh, drawn by the same indirect command
+    struct MeshBatch {
+        Mesh const* mesh;
+        uint32_t objectCount;
+    };
+
+    struct FrameResources {
+        // Host copy of the objects, only the dirty range is written before culling
+        VkBuffer objectBuffer;
+        Allocation objectMemory;
+        uint32_t dirtyBegin;
+        uint32_t dirtyEnd;
+
+        // One command per batch, the instance counts are filled by the compute pass
+        VkBuffer commandBuffer;
+        Allocation commandMemory;
+
+        // Model matrices of the visible objects, read by the vertex shader at gl_InstanceIndex
+        VkBuffer visibleBuffer;
+        Allocation visibleMemory;
+
+        VkDescriptorSet cullDescriptorSet;
+        VkDescriptorSet drawDescriptorSet;
+    };
+
+public:
+    static constexpr uint32_t DEFAULT_CAPACITY = 65536;
+    static constexpr uint32_t MAX_MESHES = 1024;
+
+    GpuScene(RenderContext& context, uint32_t capacity = DEFAULT_CAPACITY);
+    ~GpuScene();
+
+    // Returns the index used to move the object later
+    uint32_t addObject(Mesh const& mesh, mat4 const& transform);
+    void setTransform(uint32_t object, mat4 const& transform);
+
+    uint32_t getObjectCount() const;
+    uint32_t getCapacity() const;
+
+    // Recorded outside of the render pass, fills the draw commands of the frame slot
+    void cull(VkCommandBuffer commandBuffer, uint32_t frame, Frustum const& frustum);
+    // Recorded inside the render pass, returns the number of draw calls
+    uint32_t draw(VkCommandBuffer commandBuffer, uint32_t frame, RenderPipeline& pipeline);
+
+private:
+    RenderContext* m_context;
+    VkDevice const* m_device;
+
+    uint32_t m_capacity;
+    std::vector<ObjectData> m_objects;
+    std::vector<MeshBatch> m_batches;
+    std::unordered_map<Mesh const*, uint32_t> m_batchIndices;
+
+    std::vector<FrameResources> m_frames;
+
+    // Both layouts reflected from cull.comp, owned by the layout cache
+    VkDescriptorSetLayout m_cullDescriptorSetLayout;
+    VkPipelineLayout m_cullPipelineLayout;
+    VkDescriptorPool m_cullDescriptorPool;
+    VkPipeline m_cullPipeline;
+
+    void createCullPipeline();
+    void createFrameResources();
+    void markDirty(uint32_t object);
+
+};
@@ -85,7 +85,7 @@ int GuiHandler::inject(RenderWindow* window)
 	init_info.Device = Application::getInstance()->getDevice();
 	init_info.QueueFamily = queueFamilyIndices.graphicsFamily.value();
 	init_info.Queue = Application::getInstance()->getGraphicQueue();
-	init_info.PipelineCache = nullptr;
+	init_info.PipelineCache = Application::getInstance()->getPipelineCache();
 	init_info.DescriptorPool = m_imguiPools[index];
 	init_info.RenderPass = window->getRenderPass();
 	init_info.Subpass = 0;
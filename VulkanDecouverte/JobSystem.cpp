@@ -0,0 +1,315 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <string>
+
+#include "Profiler.h"
+
+// Index of the queue owned by the current thread, only set on the workers
+static thread_local int32_t sWorkerIndex = -1;
+
+bool JobSystem::Counter::isDone() const
+{
+    return m_pending.load(std::memory_order_acquire) == 0;
+}
+
+JobSystem::JobSystem(uint32_t workerCount)
+    : m_mainThread(std::this_thread::get_id())
+{
+
+    if (workerCount == 0) {
+        workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+
+    m_queues = std::vector<WorkQueue>(workerCount + 1);
+
+    m_workers.reserve(workerCount);
+    for (uint32_t worker = 0; worker < workerCount; worker++) {
+        m_workers.emplace_back(&JobSystem::workerLoop, this, worker);
+    }
+
+}
+
+JobSystem::~JobSystem()
+{
+
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stopping = true;
+    }
+    m_wakeCondition.notify_all();
+
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+
+}
+
+void JobSystem::schedule(Job job, Counter* counter, Counter* dependency)
+{
+
+    if (counter != nullptr) {
+        counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (dependency != nullptr)
+    {
+        // Under the lock, so the last job of the dependency either sees this continuation or was already done
+        std::lock_guard<std::mutex> lock(dependency->m_mutex);
+        if (!dependency->isDone())
+        {
+            dependency->m_continuations.push_back({ std::move(job), counter });
+            return;
+        }
+    }
+
+    push({ std::move(job), counter });
+
+}
+
+void JobSystem::parallelFor(uint32_t count, uint32_t grainSize, std::function<void(uint32_t begin, uint32_t end)> const& function)
+{
+
+    grainSize = std::max(grainSize, 1u);
+
+    // Not worth a job
+    if (count <= grainSize)
+    {
+        if (count > 0) function(0, count);
+        return;
+    }
+
+    Counter counter;
+    for (uint32_t begin = grainSize; begin < count; begin += grainSize)
+    {
+        uint32_t end = std::min(begin + grainSize, count);
+        schedule([&function, begin, end]() { function(begin, end); }, &counter);
+    }
+
+    // The first range is ours, the others are probably still queued when it ends.
+    // They reference function, so they are waited for even when ours throws
+    std::exception_ptr exception;
+    try {
+        function(0, grainSize);
+    } catch (...) {
+        exception = std::current_exception();
+    }
+
+    try {
+        wait(counter);
+    } catch (...) {
+        if (!exception) exception = std::current_exception();
+    }
+
+    if (exception) std::rethrow_exception(exception);
+
+}
+
+void JobSystem::wait(Counter& counter)
+{
+
+    while (!counter.isDone())
+    {
+        if (isMainThread()) runMainThreadJobs();
+
+        if (!runOne()) {
+            std::this_thread::yield();
+        }
+    }
+
+    // The last job still holds the lock right after reaching zero, the counter can
+    // only go away once it let it go
+    std::exception_ptr exception;
+    {
+        std::lock_guard<std::mutex> lock(counter.m_mutex);
+        exception.swap(counter.m_exception);
+    }
+
+    if (exception) std::rethrow_exception(exception);
+
+}
+
+void JobSystem::scheduleOnMainThread(Job job, Counter* counter)
+{
+
+    if (counter != nullptr) {
+        counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mainThreadQueue.mutex);
+    m_mainThreadQueue.tasks.push_back({ std::move(job), counter });
+
+}
+
+void JobSystem::runMainThreadJobs()
+{
+
+    std::deque<Task> tasks;
+    {
+        std::lock_guard<std::mutex> lock(m_mainThreadQueue.mutex);
+        tasks.swap(m_mainThreadQueue.tasks);
+    }
+
+    for (Task& task : tasks) {
+        execute(task);
+    }
+
+}
+
+uint32_t JobSystem::getWorkerCount() const
+{
+    return static_cast<uint32_t>(m_workers.size());
+}
+
+bool JobSystem::isMainThread() const
+{
+    return std::this_thread::get_id() == m_mainThread;
+}
+
+uint32_t JobSystem::getThreadIndex() const
+{
+
+    // The last index would be shared by every thread outside the pool, a command pool
+    // picked with it must only ever be used by the main thread
+    assert((sWorkerIndex >= 0 || isMainThread()) && "only the main thread and the workers have a thread index");
+    return queueIndex();
+
+}
+
+void JobSystem::workerLoop(uint32_t worker)
+{
+
+    sWorkerIndex = static_cast<int32_t>(worker);
+    Profiler::SetThreadName(("Worker " + std::to_string(worker)).c_str());
+
+    while (true)
+    {
+        if (runOne()) continue;
+
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_wakeCondition.wait(lock, [this]() { return m_stopping || m_queuedTasks.load() > 0; });
+
+        if (m_stopping) return;
+    }
+
+}
+
+void JobSystem::push(Task task)
+{
+
+    WorkQueue& queue = m_queues[queueIndex()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+
+    // Taking the lock orders the count with the wait predicate of the sleeping workers
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_queuedTasks.fetch_add(1);
+    }
+    m_wakeCondition.notify_one();
+
+}
+
+bool JobSystem::runOne()
+{
+
+    uint32_t own = queueIndex();
+    uint32_t queueCount = static_cast<uint32_t>(m_queues.size());
+
+    Task task;
+    bool found = false;
+
+    // Own deque from the back, the most recent job has its data still in cache
+    {
+        WorkQueue& queue = m_queues[own];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            found = true;
+        }
+    }
+
+    // Steal the oldest job of the others, starting after our own deque so thieves spread out
+    for (uint32_t offset = 1; !found && offset < queueCount; offset++)
+    {
+        WorkQueue& queue = m_queues[(own + offset) % queueCount];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            found = true;
+        }
+    }
+
+    if (!found) return false;
+
+    m_queuedTasks.fetch_sub(1);
+
+    execute(task);
+
+    return true;
+
+}
+
+void JobSystem::execute(Task& task)
+{
+
+    std::exception_ptr exception;
+    try {
+        task.job();
+    } catch (...) {
+        exception = std::current_exception();
+    }
+
+    finish(task.counter, exception);
+
+}
+
+void JobSystem::finish(Counter* counter, std::exception_ptr exception)
+{
+
+    if (counter == nullptr)
+    {
+        // Nobody waits for this job, it cannot take the thread down either
+        if (exception)
+        {
+            try {
+                std::rethrow_exception(exception);
+            } catch (std::exception const& error) {
+                std::cout << "Job failed: " << error.what() << std::endl;
+            } catch (...) {
+                std::cout << "Job failed" << std::endl;
+            }
+        }
+        return;
+    }
+
+    // Counted down under the lock, see wait
+    std::vector<Counter::Continuation> continuations;
+    {
+        std::lock_guard<std::mutex> lock(counter->m_mutex);
+        if (exception && !counter->m_exception) {
+            counter->m_exception = exception;
+        }
+        if (counter->m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            continuations.swap(counter->m_continuations);
+        }
+    }
+
+    for (Counter::Continuation& continuation : continuations) {
+        push({ std::move(continuation.job), continuation.counter });
+    }
+
+}
+
+uint32_t JobSystem::queueIndex() const
+{
+    return sWorkerIndex >= 0 ? static_cast<uint32_t>(sWorkerIndex) : static_cast<uint32_t>(m_queues.size() - 1);
+}
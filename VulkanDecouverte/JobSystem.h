@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "framework.h"
+
+// Fixed pool of workers with one deque each. A worker takes its own jobs from the
+// back and steals from the front of the other deques when it runs dry. Jobs
+// scheduled from a thread outside the pool go to a shared deque the workers steal from.
+// A thread waiting on a counter runs jobs instead of sleeping.
+class JobSystem
+{
+public:
+    using Job = std::function<void()>;
+
+    // Jobs scheduled with a counter and not finished yet. A job can depend on a counter,
+    // it is only queued once the counter is back to zero. Wait on it before destroying it.
+    // A throwing job still counts as finished, the first exception is kept for wait
+    class Counter
+    {
+    public:
+        bool isDone() const;
+
+    private:
+        friend class JobSystem;
+
+        struct Continuation
+        {
+            Job job;
+            Counter* counter;
+        };
+
+        std::atomic<uint32_t> m_pending = 0;
+        std::mutex m_mutex;
+        std::vector<Continuation> m_continuations;
+        std::exception_ptr m_exception;
+    };
+
+    // Zero workers means one per hardware thread, minus the main thread
+    JobSystem(uint32_t workerCount = 0);
+    ~JobSystem();
+
+    JobSystem(JobSystem const&) = delete;
+    JobSystem& operator=(JobSystem const&) = delete;
+
+    void schedule(Job job, Counter* counter = nullptr, Counter* dependency = nullptr);
+    // Run function over [0, count) in ranges of grainSize, the calling thread takes part.
+    // Returns once every range is done
+    void parallelFor(uint32_t count, uint32_t grainSize, std::function<void(uint32_t begin, uint32_t end)> const& function);
+    // Rethrows the exception a job of the counter threw, once: the counter can be used again after
+    void wait(Counter& counter);
+
+    // For the calls that must stay on the main thread (GLFW, presentation),
+    // run when the main loop calls runMainThreadJobs or waits on a counter
+    void scheduleOnMainThread(Job job, Counter* counter = nullptr);
+    void runMainThreadJobs();
+
+    uint32_t getWorkerCount() const;
+    bool isMainThread() const;
+    // From 0 to getWorkerCount() for the workers, getWorkerCount() for the main thread.
+    // Indexes per thread resources, so any other thread is refused
+    uint32_t getThreadIndex() const;
+
+private:
+    struct Task
+    {
+        Job job;
+        Counter* counter;
+    };
+
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::thread> m_workers;
+    // One per worker, the last one is filled by the threads outside the pool
+    std::vector<WorkQueue> m_queues;
+
+    WorkQueue m_mainThreadQueue;
+    std::thread::id m_mainThread;
+
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wakeCondition;
+    std::atomic<uint32_t> m_queuedTasks = 0;
+    std::atomic<bool> m_stopping = false;
+
+    void workerLoop(uint32_t worker);
+    void push(Task task);
+    bool runOne();
+    // Runs the job and counts it down, an exception goes to its counter instead of the thread
+    void execute(Task& task);
+    void finish(Counter* counter, std::exception_ptr exception);
+
+    uint32_t queueIndex() const;
+
+};
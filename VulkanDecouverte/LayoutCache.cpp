@@ -0,0 +1,116 @@
+#include "LayoutCache.h"
+
+#include <algorithm>
+
+#include "ShaderReflection.h"
+
+LayoutCache::LayoutCache(VkDevice device)
+    : m_device(device)
+{
+}
+
+LayoutCache::~LayoutCache()
+{
+
+    for (auto& [key, layout] : m_pipelineLayouts) {
+        vkDestroyPipelineLayout(m_device, layout, nullptr);
+    }
+
+    for (auto& [key, layout] : m_setLayouts) {
+        vkDestroyDescriptorSetLayout(m_device, layout, nullptr);
+    }
+
+}
+
+VkDescriptorSetLayout LayoutCache::getDescriptorSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings)
+{
+
+    // The order of the bindings does not change the layout
+    std::sort(bindings.begin(), bindings.end(), [](VkDescriptorSetLayoutBinding const& a, VkDescriptorSetLayoutBinding const& b) {
+        return a.binding < b.binding;
+    });
+
+    std::vector<uint64_t> key;
+    key.reserve(bindings.size() * 4);
+    for (VkDescriptorSetLayoutBinding const& binding : bindings)
+    {
+        key.push_back(binding.binding);
+        key.push_back(binding.descriptorType);
+        key.push_back(binding.descriptorCount);
+        key.push_back(binding.stageFlags);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto found = m_setLayouts.find(key);
+    if (found != m_setLayouts.end()) return found->second;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    VkDescriptorSetLayout layout;
+    if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor set layout!");
+    }
+
+    m_setLayouts.emplace(std::move(key), layout);
+    return layout;
+
+}
+
+VkPipelineLayout LayoutCache::getPipelineLayout(std::vector<VkDescriptorSetLayout> const& setLayouts, std::vector<VkPushConstantRange> const& pushConstants)
+{
+
+    std::vector<uint64_t> key;
+    key.push_back(setLayouts.size());
+    for (VkDescriptorSetLayout setLayout : setLayouts) {
+        key.push_back((uint64_t)setLayout);
+    }
+    for (VkPushConstantRange const& range : pushConstants)
+    {
+        key.push_back(range.stageFlags);
+        key.push_back(range.offset);
+        key.push_back(range.size);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto found = m_pipelineLayouts.find(key);
+    if (found != m_pipelineLayouts.end()) return found->second;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstants.size());
+    pipelineLayoutInfo.pPushConstantRanges = pushConstants.data();
+
+    VkPipelineLayout layout;
+    if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline layout!");
+    }
+
+    m_pipelineLayouts.emplace(std::move(key), layout);
+    return layout;
+
+}
+
+VkPipelineLayout LayoutCache::getPipelineLayout(ShaderReflection const& reflection)
+{
+
+    // A set no stage uses still needs a layout, an empty one, to keep the numbering
+    std::vector<VkDescriptorSetLayout> setLayouts;
+    for (uint32_t set = 0; set < reflection.getSetCount(); set++) {
+        setLayouts.push_back(getDescriptorSetLayout(reflection.getSetBindings(set)));
+    }
+
+    std::vector<VkPushConstantRange> pushConstants;
+    if (reflection.getPushConstants().size > 0) {
+        pushConstants.push_back(reflection.getPushConstants());
+    }
+
+    return getPipelineLayout(setLayouts, pushConstants);
+
+}
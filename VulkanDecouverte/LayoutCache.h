@@ -0,0 +1,36 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+
+#include "framework.h"
+
+class ShaderReflection;
+
+// Descriptor set and pipeline layouts by content. Pipelines asking for the same
+// bindings and push constants get the same handles, which keeps their descriptor
+// sets compatible and avoids rebinding them between pipelines. Owns every layout
+// it returns, they live until the device goes away.
+class LayoutCache
+{
+public:
+    LayoutCache(VkDevice device);
+    ~LayoutCache();
+
+    LayoutCache(LayoutCache const&) = delete;
+    LayoutCache& operator=(LayoutCache const&) = delete;
+
+    // Safe from any thread
+    VkDescriptorSetLayout getDescriptorSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings);
+    VkPipelineLayout getPipelineLayout(std::vector<VkDescriptorSetLayout> const& setLayouts, std::vector<VkPushConstantRange> const& pushConstants);
+    // Every set of the merged stages, then the pipeline layout using them
+    VkPipelineLayout getPipelineLayout(ShaderReflection const& reflection);
+
+private:
+    VkDevice m_device;
+
+    std::mutex m_mutex;
+    // Keyed by the fields of the create infos, flattened
+    std::map<std::vector<uint64_t>, VkDescriptorSetLayout> m_setLayouts;
+    std::map<std::vector<uint64_t>, VkPipelineLayout> m_pipelineLayouts;
+};
@@ -0,0 +1,72 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(std::filesystem::path const& path)
+{
+
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return;
+    m_file = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) return;
+
+    m_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping == nullptr) return;
+
+    m_data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (m_data != nullptr) m_size = static_cast<size_t>(size.QuadPart);
+#else
+    m_file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_file < 0) return;
+
+    struct stat status;
+    if (fstat(m_file, &status) != 0 || status.st_size == 0) return;
+
+    void* data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, m_file, 0);
+    if (data == MAP_FAILED) return;
+
+    // Read once from start to end. The advice values are not flags, one call each
+    madvise(data, static_cast<size_t>(status.st_size), MADV_SEQUENTIAL);
+    madvise(data, static_cast<size_t>(status.st_size), MADV_WILLNEED);
+    m_data = data;
+    m_size = static_cast<size_t>(status.st_size);
+#endif
+
+}
+
+MappedFile::~MappedFile()
+{
+
+#ifdef _WIN32
+    if (m_data != nullptr) UnmapViewOfFile(m_data);
+    if (m_mapping != nullptr) CloseHandle(m_mapping);
+    if (m_file != nullptr) CloseHandle(m_file);
+#else
+    if (m_data != nullptr) munmap(m_data, m_size);
+    if (m_file >= 0) close(m_file);
+#endif
+
+}
+
+char const* MappedFile::data() const
+{
+    return static_cast<char const*>(m_data);
+}
+
+size_t MappedFile::size() const
+{
+    return m_size;
+}
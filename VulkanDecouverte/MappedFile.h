@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+// Read only view of a whole file, the pages are brought in by whoever reads them.
+// Empty when the file cannot be opened or is empty.
+class MappedFile
+{
+public:
+    explicit MappedFile(std::filesystem::path const& path);
+    ~MappedFile();
+
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    char const* data() const;
+    size_t size() const;
+
+private:
+#ifdef _WIN32
+    // HANDLE, without pulling windows.h in every includer
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#else
+    int m_file = -1;
+#endif
+    void* m_data = nullptr;
+    size_t m_size = 0;
+};
@@ -0,0 +1,387 @@
+#include "MemoryAllocator.h"
+
+#include <algorithm>
+#include <set>
+
+// Free space of a block is kept twice: offset -> size ranges, sorted so neighbours merge back
+// on free, and the same ranges ordered by size so the best fit is a lookup instead of a scan
+struct MemoryBlock
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+    VkDeviceSize used = 0;
+    void* mapped = nullptr;
+    uint32_t memoryType = 0;
+    uint32_t allocationCount = 0;
+
+    std::map<VkDeviceSize, VkDeviceSize> freeRanges;
+    std::set<std::pair<VkDeviceSize, VkDeviceSize>> freeBySize;  // (size, offset)
+
+    void addRange(VkDeviceSize offset, VkDeviceSize rangeSize)
+    {
+        freeRanges[offset] = rangeSize;
+        freeBySize.emplace(rangeSize, offset);
+    }
+
+    void removeRange(std::map<VkDeviceSize, VkDeviceSize>::iterator range)
+    {
+        freeBySize.erase({ range->second, range->first });
+        freeRanges.erase(range);
+    }
+
+    bool allocate(VkDeviceSize requestSize, VkDeviceSize alignment, VkDeviceSize& offset)
+    {
+
+        // Best fit, keeps the big ranges for the big resources. The smallest range that can
+        // hold the request may still be too small once aligned, the next ones are tried then,
+        // a range of requestSize + alignment - 1 always fits so the walk stays short
+        auto best = freeBySize.end();
+        VkDeviceSize bestWaste = ~0ull;
+
+        for (auto candidate = freeBySize.lower_bound({ requestSize, 0 }); candidate != freeBySize.end(); ++candidate)
+        {
+            VkDeviceSize rangeSize = candidate->first;
+            if (best != freeBySize.end() && rangeSize - requestSize >= bestWaste) break;
+
+            VkDeviceSize alignedOffset = (candidate->second + alignment - 1) / alignment * alignment;
+            VkDeviceSize padding = alignedOffset - candidate->second;
+            if (padding + requestSize > rangeSize) continue;
+
+            // The padding goes back to the free list, only what is left after the end is lost to this range
+            VkDeviceSize waste = rangeSize - padding - requestSize;
+            if (waste < bestWaste)
+            {
+                best = candidate;
+                bestWaste = waste;
+            }
+            if (padding == 0) break;
+        }
+
+        if (best == freeBySize.end()) return false;
+
+        VkDeviceSize rangeOffset = best->second;
+        VkDeviceSize rangeSize = best->first;
+        removeRange(freeRanges.find(rangeOffset));
+
+        offset = (rangeOffset + alignment - 1) / alignment * alignment;
+        if (offset > rangeOffset) {
+            addRange(rangeOffset, offset - rangeOffset);
+        }
+
+        VkDeviceSize end = offset + requestSize;
+        if (end < rangeOffset + rangeSize) {
+            addRange(end, rangeOffset + rangeSize - end);
+        }
+
+        used += requestSize;
+        allocationCount++;
+        return true;
+
+    }
+
+    void free(VkDeviceSize offset, VkDeviceSize freedSize)
+    {
+
+        VkDeviceSize mergedOffset = offset;
+        VkDeviceSize mergedSize = freedSize;
+
+        auto next = freeRanges.lower_bound(offset);
+        if (next != freeRanges.end() && offset + freedSize == next->first)
+        {
+            mergedSize += next->second;
+            removeRange(next);
+        }
+
+        auto previous = freeRanges.lower_bound(offset);
+        if (previous != freeRanges.begin())
+        {
+            previous = std::prev(previous);
+            if (previous->first + previous->second == offset)
+            {
+                mergedOffset = previous->first;
+                mergedSize += previous->second;
+                removeRange(previous);
+            }
+        }
+
+        addRange(mergedOffset, mergedSize);
+
+        used -= freedSize;
+        allocationCount--;
+
+    }
+};
+
+MemoryAllocator::MemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice)
+    : m_device(device)
+{
+
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    m_nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+
+    for (uint32_t type = 0; type < VK_MAX_MEMORY_TYPES; type++) {
+        for (uint32_t kind = 0; kind < RESOURCE_KIND_COUNT; kind++) {
+            for (auto& block : m_blocks[type][kind]) {
+                vkFreeMemory(m_device, block->memory, nullptr);
+            }
+        }
+    }
+
+    for (Allocation& allocation : m_dedicated) {
+        vkFreeMemory(m_device, allocation.memory, nullptr);
+    }
+
+}
+
+Allocation MemoryAllocator::allocate(VkMemoryRequirements const& requirements, VkMemoryPropertyFlags properties, ResourceKind kind)
+{
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+    VkMemoryPropertyFlags typeFlags = m_memoryProperties.memoryTypes[memoryType].propertyFlags;
+
+    VkDeviceSize size = requirements.size;
+    VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+
+    // Non coherent ranges are flushed by whole atoms, they must not share one with a neighbour
+    if ((typeFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(typeFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+        alignment = std::max(alignment, m_nonCoherentAtomSize);
+        size = (size + m_nonCoherentAtomSize - 1) / m_nonCoherentAtomSize * m_nonCoherentAtomSize;
+    }
+
+    VkDeviceSize blockSize = getBlockSize(memoryType);
+    if (size > blockSize / 2) {
+        return allocateDedicated(memoryType, size);
+    }
+
+    std::vector<std::unique_ptr<MemoryBlock>>& blocks = m_blocks[memoryType][kind];
+
+    Allocation allocation;
+    allocation.memoryType = memoryType;
+    allocation.size = size;
+
+    for (auto& block : blocks)
+    {
+        if (block->size - block->used < size) continue;
+        if (!block->allocate(size, alignment, allocation.offset)) continue;
+
+        allocation.memory = block->memory;
+        allocation.block = block.get();
+        allocation.mapped = block->mapped ? static_cast<char*>(block->mapped) + allocation.offset : nullptr;
+        return allocation;
+    }
+
+    auto block = std::make_unique<MemoryBlock>();
+    block->memoryType = memoryType;
+    block->size = blockSize;
+    block->memory = allocateMemory(memoryType, blockSize, &block->mapped);
+    block->addRange(0, blockSize);
+    block->allocate(size, alignment, allocation.offset);
+
+    allocation.memory = block->memory;
+    allocation.block = block.get();
+    allocation.mapped = block->mapped ? static_cast<char*>(block->mapped) + allocation.offset : nullptr;
+
+    blocks.push_back(std::move(block));
+
+    return allocation;
+
+}
+
+void MemoryAllocator::free(Allocation& allocation)
+{
+
+    if (allocation.memory == VK_NULL_HANDLE) return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (allocation.block == nullptr)
+    {
+        auto dedicated = std::find_if(m_dedicated.begin(), m_dedicated.end(),
+            [&allocation](Allocation const& other) { return other.memory == allocation.memory; });
+        if (dedicated != m_dedicated.end()) m_dedicated.erase(dedicated);
+
+        vkFreeMemory(m_device, allocation.memory, nullptr);
+    }
+    else
+    {
+        MemoryBlock* block = allocation.block;
+        block->free(allocation.offset, allocation.size);
+
+        // Keep one empty block around per pool so a load/unload loop does not hit the driver each time
+        if (block->allocationCount == 0)
+        {
+            for (uint32_t kind = 0; kind < RESOURCE_KIND_COUNT; kind++)
+            {
+                std::vector<std::unique_ptr<MemoryBlock>>& blocks = m_blocks[block->memoryType][kind];
+                auto owner = std::find_if(blocks.begin(), blocks.end(),
+                    [block](std::unique_ptr<MemoryBlock> const& other) { return other.get() == block; });
+                if (owner == blocks.end()) continue;
+
+                size_t emptyBlocks = std::count_if(blocks.begin(), blocks.end(),
+                    [](std::unique_ptr<MemoryBlock> const& other) { return other->allocationCount == 0; });
+                if (emptyBlocks > 1)
+                {
+                    vkFreeMemory(m_device, block->memory, nullptr);
+                    blocks.erase(owner);
+                }
+                break;
+            }
+        }
+    }
+
+    allocation = Allocation{};
+
+}
+
+void MemoryAllocator::flush(Allocation const& allocation)
+{
+
+    VkMemoryPropertyFlags typeFlags = m_memoryProperties.memoryTypes[allocation.memoryType].propertyFlags;
+    if (typeFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) return;
+
+    VkMappedMemoryRange range{};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = allocation.memory;
+    range.offset = allocation.offset;
+    range.size = allocation.size;
+
+    vkFlushMappedMemoryRanges(m_device, 1, &range);
+
+}
+
+std::vector<MemoryAllocator::HeapStats> MemoryAllocator::getHeapStats()
+{
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::vector<HeapStats> heaps(m_memoryProperties.memoryHeapCount);
+    std::vector<VkDeviceSize> freeSpace(m_memoryProperties.memoryHeapCount, 0);
+
+    for (uint32_t heap = 0; heap < m_memoryProperties.memoryHeapCount; heap++) {
+        heaps[heap].heapSize = m_memoryProperties.memoryHeaps[heap].size;
+    }
+
+    for (uint32_t type = 0; type < m_memoryProperties.memoryTypeCount; type++)
+    {
+        uint32_t heap = m_memoryProperties.memoryTypes[type].heapIndex;
+
+        for (uint32_t kind = 0; kind < RESOURCE_KIND_COUNT; kind++) {
+            for (auto& block : m_blocks[type][kind])
+            {
+                HeapStats& stats = heaps[heap];
+                stats.reserved += block->size;
+                stats.used += block->used;
+                stats.blockCount++;
+                stats.allocationCount += block->allocationCount;
+                stats.freeRangeCount += static_cast<uint32_t>(block->freeRanges.size());
+
+                if (!block->freeBySize.empty()) {
+                    stats.largestFreeRange = std::max(stats.largestFreeRange, block->freeBySize.rbegin()->first);
+                }
+                freeSpace[heap] += block->size - block->used;
+            }
+        }
+    }
+
+    for (Allocation const& allocation : m_dedicated)
+    {
+        HeapStats& stats = heaps[m_memoryProperties.memoryTypes[allocation.memoryType].heapIndex];
+        stats.reserved += allocation.size;
+        stats.used += allocation.size;
+        stats.dedicatedCount++;
+        stats.allocationCount++;
+    }
+
+    for (uint32_t heap = 0; heap < m_memoryProperties.memoryHeapCount; heap++) {
+        if (freeSpace[heap] > 0) {
+            heaps[heap].fragmentation = 1.0f - (float)heaps[heap].largestFreeRange / (float)freeSpace[heap];
+        }
+    }
+
+    return heaps;
+
+}
+
+void MemoryAllocator::printStats(std::ostream& out)
+{
+
+    std::vector<HeapStats> heaps = getHeapStats();
+
+    for (size_t heap = 0; heap < heaps.size(); heap++)
+    {
+        HeapStats const& stats = heaps[heap];
+        out << "Heap " << heap << " (" << stats.heapSize / (1024 * 1024) << " MB): "
+            << stats.used / 1024 << " KB used / " << stats.reserved / 1024 << " KB reserved, "
+            << stats.blockCount << " blocks, " << stats.dedicatedCount << " dedicated, "
+            << stats.allocationCount << " allocations, "
+            << stats.freeRangeCount << " free ranges, fragmentation " << stats.fragmentation << std::endl;
+    }
+
+}
+
+uint32_t MemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+{
+
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("failed to find suitable memory type!");
+
+}
+
+VkDeviceSize MemoryAllocator::getBlockSize(uint32_t memoryType)
+{
+    // Small heaps (BAR memory, integrated GPUs) get smaller blocks
+    VkDeviceSize heapSize = m_memoryProperties.memoryHeaps[m_memoryProperties.memoryTypes[memoryType].heapIndex].size;
+    return std::min(DEFAULT_BLOCK_SIZE, heapSize / 8);
+}
+
+VkDeviceMemory MemoryAllocator::allocateMemory(uint32_t memoryType, VkDeviceSize size, void** mapped)
+{
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    VkDeviceMemory memory;
+    if (vkAllocateMemory(m_device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate device memory!");
+    }
+
+    // Host visible memory stays mapped for its whole life, a memory object can only be mapped once
+    *mapped = nullptr;
+    if (m_memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, mapped);
+    }
+
+    return memory;
+
+}
+
+Allocation MemoryAllocator::allocateDedicated(uint32_t memoryType, VkDeviceSize size)
+{
+
+    Allocation allocation;
+    allocation.memoryType = memoryType;
+    allocation.size = size;
+    allocation.memory = allocateMemory(memoryType, size, &allocation.mapped);
+
+    m_dedicated.push_back(allocation);
+
+    return allocation;
+
+}
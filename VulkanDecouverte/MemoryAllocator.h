@@ -0,0 +1,85 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+
+#include "framework.h"
+
+struct MemoryBlock;
+
+// Range of device memory handed to a buffer or an image
+struct Allocation
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    // Persistent mapping of host visible memory, already offset to the allocation
+    void* mapped = nullptr;
+    uint32_t memoryType = 0;
+    // Owning block, nullptr for a dedicated allocation
+    MemoryBlock* block = nullptr;
+};
+
+// Sub-allocates resources from large vkAllocateMemory blocks, one set of blocks per
+// memory type. Buffers and optimal images never share a block so bufferImageGranularity
+// does not have to be tracked. Allocations bigger than half a block get their own memory.
+// There is no linear pool here on purpose: the short lived data already has its own bump
+// allocators on top of long lived allocations, the staging ring of UploadManager and the
+// per frame object pages of RenderContext, so only resources with a real lifetime come here.
+class MemoryAllocator
+{
+public:
+    enum ResourceKind
+    {
+        LINEAR,  // buffers and linear images
+        OPTIMAL, // optimal tiling images
+
+        RESOURCE_KIND_COUNT
+    };
+
+    struct HeapStats
+    {
+        VkDeviceSize heapSize = 0;
+        VkDeviceSize reserved = 0;  // memory allocated from the driver
+        VkDeviceSize used = 0;      // memory handed to resources
+        uint32_t blockCount = 0;
+        uint32_t dedicatedCount = 0;
+        uint32_t allocationCount = 0;
+        uint32_t freeRangeCount = 0;
+        VkDeviceSize largestFreeRange = 0;
+        // 0 when the free space is one range, close to 1 when it is scattered in small holes
+        float fragmentation = 0.0f;
+    };
+
+    MemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice);
+    ~MemoryAllocator();
+
+    Allocation allocate(VkMemoryRequirements const& requirements, VkMemoryPropertyFlags properties, ResourceKind kind);
+    void free(Allocation& allocation);
+
+    // Needed for host visible memory that is not host coherent
+    void flush(Allocation const& allocation);
+
+    std::vector<HeapStats> getHeapStats();
+    void printStats(std::ostream& out);
+
+    static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+private:
+    VkDevice m_device;
+    VkPhysicalDeviceMemoryProperties m_memoryProperties;
+    VkDeviceSize m_nonCoherentAtomSize;
+
+    std::mutex m_mutex;
+
+    std::vector<std::unique_ptr<MemoryBlock>> m_blocks[VK_MAX_MEMORY_TYPES][RESOURCE_KIND_COUNT];
+    std::vector<Allocation> m_dedicated;
+
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+    VkDeviceSize getBlockSize(uint32_t memoryType);
+    VkDeviceMemory allocateMemory(uint32_t memoryType, VkDeviceSize size, void** mapped);
+    Allocation allocateDedicated(uint32_t memoryType, VkDeviceSize size);
+
+};
@@ -1,63 +1,80 @@
 ﻿#include "Mesh.h"
 
-#include "RenderWindow.h"
+#include <algorithm>
+#include <cassert>
+
+#include "Profiler.h"
+#include "RenderContext.h"
+#include "UploadManager.h"
 
 Vertex::Vertex(): position(0, 0, 0), normal(0, 0, 0), texCoords(0, 0) {}
 
 Vertex::Vertex(float x, float y, float z, float xN, float yN, float zN, float xT, float yT)
     : position(x, y, z), normal(xN, yN, zN), texCoords(xT, yT) {}
 
-Mesh::Mesh(RenderWindow& window, MeshData* dMesh) : m_vertexBuffer(nullptr)
+Mesh::Mesh(RenderContext& context, MeshData* dMesh) : m_vertexBuffer(nullptr)
 {
+
+    PROFILE_SCOPE("Mesh upload");
     
-    m_window = &window;
+    m_context = &context;
     m_meshData = dMesh;
+    // Meshes are created by the loading jobs too
+    m_id = sNextId.fetch_add(1, std::memory_order_relaxed);
 
     uint64_t vSize = sizeof(dMesh->Vertices[0]) * dMesh->Vertices.size();
-    assert(vSize > 0, "A mesh is using an empty data");
-
-    VkBuffer stagingBuffer = nullptr;
-    VkDeviceMemory stagingBufferMemory = nullptr;
-    Application::getInstance()->createBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            stagingBuffer, stagingBufferMemory, vSize);
+    assert(vSize > 0 && "A mesh is using an empty data");
 
-    void* data;
-    vkMapMemory(Application::getInstance()->getDevice(), stagingBufferMemory, 0, vSize, 0, &data);
-    memcpy(data, dMesh->Vertices.data(), vSize);
-    vkUnmapMemory(Application::getInstance()->getDevice(), stagingBufferMemory);
+    VkDeviceSize iSize = sizeof(dMesh->Indices[0]) * dMesh->Indices.size();
 
     Application::getInstance()->createBuffer(VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         m_vertexBuffer, m_vertexUploader, vSize);
 
-    window.copyBuffer(stagingBuffer, m_vertexBuffer, vSize);
-
-    VkDeviceSize iSize = sizeof(dMesh->Indices[0]) * dMesh->Indices.size();
-    
-    vkMapMemory(Application::getInstance()->getDevice(), stagingBufferMemory, 0, iSize, 0, &data);
-    memcpy(data, dMesh->Indices.data(), iSize);
-    vkUnmapMemory(Application::getInstance()->getDevice(), stagingBufferMemory);
-
     Application::getInstance()->createBuffer(VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         m_indexBuffer, m_indexBufferUploader, iSize);
 
-    window.copyBuffer(stagingBuffer, m_indexBuffer, iSize);
+    // Both copies land in the current upload batch, sent with the next frame
+    UploadManager& uploads = Application::getInstance()->getUploadManager();
+    uploads.uploadBuffer(m_vertexBuffer, dMesh->Vertices.data(), vSize);
+    m_uploadTicket = uploads.uploadBuffer(m_indexBuffer, dMesh->Indices.data(), iSize);
 
-    vkDestroyBuffer(Application::getInstance()->getDevice(), stagingBuffer, nullptr);
-    vkFreeMemory(Application::getInstance()->getDevice(), stagingBufferMemory, nullptr);
+    m_boundingSphere = dMesh->BoundingSphere ? *dMesh->BoundingSphere : ComputeBoundingSphere(dMesh->Vertices);
     
 }
 
+vec4 Mesh::ComputeBoundingSphere(std::vector<Vertex> const& vertices)
+{
+
+    if (vertices.empty()) return vec4(0.0f);
+
+    vec3 minimum = vertices[0].position;
+    vec3 maximum = vertices[0].position;
+    for (Vertex const& vertex : vertices) {
+        minimum = min(minimum, vertex.position);
+        maximum = max(maximum, vertex.position);
+    }
+
+    vec3 center = (minimum + maximum) * 0.5f;
+    float radius = 0.0f;
+    for (Vertex const& vertex : vertices) {
+        radius = std::max(radius, distance(center, vertex.position));
+    }
+
+    return vec4(center, radius);
+
+}
+
 Mesh::~Mesh()
 {
 
-    vkDestroyBuffer(Application::getInstance()->getDevice(), m_indexBuffer, nullptr);
-    vkFreeMemory(Application::getInstance()->getDevice(), m_indexBufferUploader, nullptr);
+    // The buffers can still be the destination of a pending copy
+    Application::getInstance()->getUploadManager().wait(m_uploadTicket);
+
+    Application::getInstance()->destroyBuffer(m_indexBuffer, m_indexBufferUploader);
     
-    vkDestroyBuffer(Application::getInstance()->getDevice(), m_vertexBuffer, nullptr);
-    vkFreeMemory(Application::getInstance()->getDevice(), m_vertexUploader, nullptr);
+    Application::getInstance()->destroyBuffer(m_vertexBuffer, m_vertexUploader);
     
 }
 
@@ -80,3 +97,13 @@ uint32 Mesh::getIndexCount() const
 {
     return m_meshData->Indices.size();
 }
+
+uint32_t Mesh::getId() const
+{
+    return m_id;
+}
+
+vec4 const& Mesh::getBoundingSphere() const
+{
+    return m_boundingSphere;
+}
@@ -1,8 +1,12 @@
 ﻿#pragma once
 
+#include <atomic>
+
 #include "framework.h"
 
-class RenderWindow;
+#include "MemoryAllocator.h"
+
+class RenderContext;
 
 struct Vertex
 {
@@ -48,27 +52,45 @@ struct MeshData
 {
     std::vector<Vertex> Vertices;
     std::vector<uint32> Indices;
+    // Known when loaded from a mesh file, computed by Mesh otherwise
+    std::optional<vec4> BoundingSphere;
 };
 
 class Mesh
 {
 
-    RenderWindow* m_window;
+    RenderContext* m_context;
     MeshData* m_meshData;
     
     VkBuffer m_vertexBuffer;
-    VkDeviceMemory m_vertexUploader;
+    Allocation m_vertexUploader;
 
     VkBuffer m_indexBuffer;
-    VkDeviceMemory m_indexBufferUploader;
+    Allocation m_indexBufferUploader;
+
+    // Upload batch holding the copies of both buffers
+    uint64_t m_uploadTicket;
+
+    // Model space, center in xyz and radius in w
+    vec4 m_boundingSphere;
+
+    // Small and stable, used in the render queue sort keys
+    uint32_t m_id;
+    static inline std::atomic<uint32_t> sNextId = 0;
 
 public:
-    Mesh(RenderWindow& window, MeshData* data);
+    // Safe from a job, the copies are recorded into the upload batch of the next frame
+    Mesh(RenderContext& context, MeshData* data);
     ~Mesh();
 
     VkBuffer const& getVertexBuffer() const;
     VkBuffer const& getIndexBuffer() const;
     std::vector<Vertex> const& getVertices() const;
     uint32 getIndexCount() const;
+    uint32_t getId() const;
+    vec4 const& getBoundingSphere() const;
+
+    // Centered on the box around the vertices, not the smallest sphere but close enough to cull
+    static vec4 ComputeBoundingSphere(std::vector<Vertex> const& vertices);
     
 };
@@ -0,0 +1,288 @@
+#include "MeshCache.h"
+
+#include <algorithm>
+#include <filesystem>
+
+#include "Application.h"
+#include "GeometryFactory.h"
+#include "Mesh.h"
+#include "Profiler.h"
+
+MeshHandle::MeshHandle(Entry* entry)
+    : m_entry(entry)
+{
+    if (m_entry != nullptr) m_entry->references.fetch_add(1, std::memory_order_relaxed);
+}
+
+MeshHandle::MeshHandle(MeshHandle const& other)
+    : MeshHandle(other.m_entry)
+{
+}
+
+MeshHandle::MeshHandle(MeshHandle&& other) noexcept
+    : m_entry(other.m_entry)
+{
+    other.m_entry = nullptr;
+}
+
+MeshHandle& MeshHandle::operator=(MeshHandle other) noexcept
+{
+    std::swap(m_entry, other.m_entry);
+    return *this;
+}
+
+MeshHandle::~MeshHandle()
+{
+
+    if (m_entry == nullptr) return;
+
+    // Stamped before the count drops, an evictable entry always has its last use
+    m_entry->lastUse.store(m_entry->cache->m_clock.fetch_add(1, std::memory_order_relaxed), std::memory_order_relaxed);
+    m_entry->references.fetch_sub(1, std::memory_order_release);
+
+}
+
+Mesh* MeshHandle::get() const
+{
+    return isReady() ? m_entry->mesh : nullptr;
+}
+
+MeshData const* MeshHandle::getData() const
+{
+    return isReady() ? m_entry->data : nullptr;
+}
+
+bool MeshHandle::isReady() const
+{
+    return m_entry != nullptr && m_entry->state.load(std::memory_order_acquire) == Entry::State::READY;
+}
+
+bool MeshHandle::isFailed() const
+{
+    return m_entry != nullptr && m_entry->state.load(std::memory_order_acquire) == Entry::State::FAILED;
+}
+
+MeshCache::MeshCache(RenderContext& context, size_t budget)
+    : m_context(context), m_budget(budget)
+{
+}
+
+MeshCache::~MeshCache()
+{
+
+    for (auto& [key, entry] : m_entries) {
+        Application::getInstance()->getJobSystem().wait(entry->loaded);
+    }
+
+    for (RetiredMesh& retired : m_retired)
+    {
+        delete retired.mesh;
+        delete retired.data;
+    }
+
+    for (auto& [key, entry] : m_entries)
+    {
+        delete entry->mesh;
+        delete entry->data;
+    }
+
+}
+
+MeshHandle MeshCache::load(std::wstring const& path, bool invertV)
+{
+
+    MeshHandle handle = acquire(path, invertV);
+
+    // Runs other jobs meanwhile, the load itself when nobody took it yet
+    Application::getInstance()->getJobSystem().wait(handle.m_entry->loaded);
+
+    return handle;
+
+}
+
+MeshHandle MeshCache::loadAsync(std::wstring const& path, bool invertV)
+{
+    return acquire(path, invertV);
+}
+
+MeshHandle MeshCache::loadPrimitive(Primitive::Type type)
+{
+
+    // Never a valid file name, a primitive cannot collide with a model
+    static wchar_t const* const NAMES[Primitive::PRIMITIVE_COUNT] = { L"<cube>", L"<plane>" };
+
+    MeshHandle handle = acquire(NAMES[type], false, type);
+    Application::getInstance()->getJobSystem().wait(handle.m_entry->loaded);
+
+    return handle;
+
+}
+
+MeshHandle MeshCache::acquire(std::wstring const& path, bool invertV, Primitive::Type primitive)
+{
+
+    // The handle is made under the lock, eviction cannot take the entry before it counts
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto found = m_entries.find({ path, invertV });
+    if (found != m_entries.end()) return MeshHandle(found->second.get());
+
+    std::unique_ptr<MeshHandle::Entry> created = std::make_unique<MeshHandle::Entry>();
+    created->cache = this;
+    created->path = path;
+    created->invertV = invertV;
+    created->primitive = primitive;
+
+    MeshHandle::Entry* entry = created.get();
+    m_entries.emplace(Key(path, invertV), std::move(created));
+
+    Application::getInstance()->getJobSystem().schedule([this, entry]() { loadEntry(*entry); }, &entry->loaded);
+
+    return MeshHandle(entry);
+
+}
+
+void MeshCache::loadEntry(MeshHandle::Entry& entry)
+{
+
+    PROFILE_FUNCTION();
+
+    MeshData* data = nullptr;
+
+    // A failure is a failed load for the handles, nothing reaches the threads waiting on the job
+    try
+    {
+        data = entry.primitive != Primitive::PRIMITIVE_COUNT
+            ? GeometryFactory::CreatePrimitive(entry.primitive)
+            : GeometryFactory::LoadMeshFromFile(entry.path, entry.invertV);
+
+        if (data->Vertices.empty() || data->Indices.empty()) {
+            throw std::runtime_error("no triangle could be read");
+        }
+
+        // Only stages the copies, they reach the queue with the next submit of the main thread.
+        // A full ring blocks this job until the main thread sent the batch, it never submits
+        entry.mesh = new Mesh(m_context, data);
+    }
+    catch (std::exception const& exception)
+    {
+        std::cout << "Cannot load mesh " << std::filesystem::path(entry.path).string() << ": " << exception.what() << std::endl;
+        delete data;
+        entry.state.store(MeshHandle::Entry::State::FAILED, std::memory_order_release);
+        return;
+    }
+
+    entry.data = data;
+    // Kept on both sides, the CPU copy for the bounds and the vertex queries
+    entry.bytes = 2 * (data->Vertices.size() * sizeof(Vertex) + data->Indices.size() * sizeof(uint32));
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_residentBytes += entry.bytes;
+    }
+
+    entry.state.store(MeshHandle::Entry::State::READY, std::memory_order_release);
+
+}
+
+void MeshCache::collect(uint32_t framesInFlight)
+{
+
+    // Every frame that could still draw a retired mesh was waited for
+    for (size_t i = 0; i < m_retired.size();)
+    {
+        if (--m_retired[i].framesLeft == 0)
+        {
+            delete m_retired[i].mesh;
+            delete m_retired[i].data;
+            m_retired[i] = m_retired.back();
+            m_retired.pop_back();
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Failed loads are forgotten once released, the next request tries again
+    for (auto it = m_entries.begin(); it != m_entries.end();)
+    {
+        if (it->second->state.load(std::memory_order_acquire) == MeshHandle::Entry::State::FAILED && isEvictable(*it->second)) {
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (m_residentBytes <= m_budget) return;
+
+    PROFILE_SCOPE("Mesh eviction");
+
+    std::vector<MeshHandle::Entry*> candidates;
+    for (auto& [key, entry] : m_entries)
+    {
+        if (entry->state.load(std::memory_order_acquire) == MeshHandle::Entry::State::READY && isEvictable(*entry)) {
+            candidates.push_back(entry.get());
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](MeshHandle::Entry const* a, MeshHandle::Entry const* b) {
+        return a->lastUse.load(std::memory_order_relaxed) < b->lastUse.load(std::memory_order_relaxed);
+    });
+
+    for (MeshHandle::Entry* entry : candidates)
+    {
+        if (m_residentBytes <= m_budget) break;
+
+        // The draws of the frames in flight may still read the buffers
+        m_retired.push_back({ entry->mesh, entry->data, framesInFlight });
+        m_residentBytes -= entry->bytes;
+        m_entries.erase({ entry->path, entry->invertV });
+    }
+
+}
+
+bool MeshCache::isEvictable(MeshHandle::Entry& entry)
+{
+
+    if (entry.references.load(std::memory_order_acquire) != 0 || !entry.loaded.isDone()) return false;
+
+    // Does not block once done, makes sure the load job let go of the counter
+    Application::getInstance()->getJobSystem().wait(entry.loaded);
+    return true;
+
+}
+
+void MeshCache::setBudget(size_t bytes)
+{
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budget = bytes;
+
+}
+
+size_t MeshCache::getBudget() const
+{
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_budget;
+
+}
+
+size_t MeshCache::getResidentBytes() const
+{
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_residentBytes;
+
+}
+
+size_t MeshCache::size() const
+{
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+
+}
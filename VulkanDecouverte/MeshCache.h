@@ -0,0 +1,135 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "framework.h"
+
+#include "GeometryFactory.h"
+#include "JobSystem.h"
+
+class Mesh;
+class MeshCache;
+class RenderContext;
+struct MeshData;
+
+// Counted reference to a mesh of the cache, the mesh is never evicted while one exists.
+// Empty handles and handles of a mesh still loading give null.
+class MeshHandle
+{
+public:
+    MeshHandle() = default;
+    MeshHandle(MeshHandle const& other);
+    MeshHandle(MeshHandle&& other) noexcept;
+    MeshHandle& operator=(MeshHandle other) noexcept;
+    ~MeshHandle();
+
+    // Null until the load is done, and for good when it failed
+    Mesh* get() const;
+    MeshData const* getData() const;
+    bool isReady() const;
+    bool isFailed() const;
+
+private:
+    friend class MeshCache;
+
+    struct Entry;
+    explicit MeshHandle(Entry* entry);
+
+    Entry* m_entry = nullptr;
+};
+
+// Meshes by file path and V orientation, each loaded once and shared. Loads run on the
+// job system and concurrent requests for the same mesh wait on that single load. The meshes no handle
+// refers to anymore stay resident until the CPU and GPU copies of all the meshes go
+// over the budget, the least recently released are evicted first. Owned by a render
+// context, collect is called at every frame boundary.
+class MeshCache
+{
+public:
+    MeshCache(RenderContext& context, size_t budget = DEFAULT_BUDGET);
+    // Waits for the loads still running. Every handle has to be released before
+    ~MeshCache();
+
+    MeshCache(MeshCache const&) = delete;
+    MeshCache& operator=(MeshCache const&) = delete;
+
+    // Safe from any thread. Returns once the mesh is loaded, or its load failed
+    MeshHandle load(std::wstring const& path, bool invertV);
+    // Returns at once, the handle gives null until the job is done
+    MeshHandle loadAsync(std::wstring const& path, bool invertV);
+    // Unit sized primitive, built instead of read from a file but cached the same way
+    MeshHandle loadPrimitive(Primitive::Type type);
+
+    // At a frame boundary, once the frame slot fence was waited for: evicts down to the
+    // budget and destroys the meshes evicted framesInFlight boundaries ago
+    void collect(uint32_t framesInFlight);
+
+    void setBudget(size_t bytes);
+    size_t getBudget() const;
+    // CPU and GPU copies of the resident meshes, referenced or not
+    size_t getResidentBytes() const;
+    size_t size() const;
+
+    static constexpr size_t DEFAULT_BUDGET = 512ull * 1024 * 1024;
+
+private:
+    friend class MeshHandle;
+
+    RenderContext& m_context;
+
+    // The same file flipped or not is two different meshes
+    using Key = std::pair<std::wstring, bool>;
+
+    struct KeyHash
+    {
+        size_t operator()(Key const& key) const { return std::hash<std::wstring>()(key.first) ^ (key.second ? 1 : 0); }
+    };
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<Key, std::unique_ptr<MeshHandle::Entry>, KeyHash> m_entries;
+
+    size_t m_budget;
+    size_t m_residentBytes = 0;
+    // Stamps the releases, the smallest stamp is the least recently used
+    std::atomic<uint64_t> m_clock = 0;
+
+    struct RetiredMesh
+    {
+        Mesh* mesh;
+        MeshData* data;
+        uint32_t framesLeft;
+    };
+
+    // Only touched at frame boundaries
+    std::vector<RetiredMesh> m_retired;
+
+    MeshHandle acquire(std::wstring const& path, bool invertV, Primitive::Type primitive = Primitive::PRIMITIVE_COUNT);
+    void loadEntry(MeshHandle::Entry& entry);
+    // Unreferenced and its load job is completely over
+    bool isEvictable(MeshHandle::Entry& entry);
+};
+
+struct MeshHandle::Entry
+{
+    enum class State { LOADING, READY, FAILED };
+
+    MeshCache* cache;
+    std::wstring path;
+    bool invertV;
+    // PRIMITIVE_COUNT for a mesh read from its file
+    Primitive::Type primitive;
+
+    std::atomic<State> state{ State::LOADING };
+    JobSystem::Counter loaded;
+    MeshData* data = nullptr;
+    Mesh* mesh = nullptr;
+    size_t bytes = 0;
+
+    std::atomic<uint32_t> references = 0;
+    std::atomic<uint64_t> lastUse = 0;
+};
@@ -0,0 +1,113 @@
+#include "MeshFile.h"
+
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+#include "MappedFile.h"
+#include "Profiler.h"
+
+static_assert(std::is_trivially_copyable_v<Vertex>, "the vertex stream is copied as raw bytes");
+
+namespace
+{
+    constexpr uint64_t STREAM_ALIGNMENT = 16;
+
+    uint64_t alignUp(uint64_t value)
+    {
+        return (value + STREAM_ALIGNMENT - 1) & ~(STREAM_ALIGNMENT - 1);
+    }
+}
+
+MeshData* MeshFile::Load(std::filesystem::path const& path, std::optional<uint32_t> expectedFlags)
+{
+
+    PROFILE_FUNCTION();
+
+    MappedFile file(path);
+    if (file.size() < sizeof(MeshFileHeader)) return nullptr;
+
+    MeshFileHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    if (header.magic != MeshFileHeader::MAGIC || header.version != MeshFileHeader::VERSION
+        || header.vertexStride != sizeof(Vertex) || (expectedFlags && header.flags != *expectedFlags)) {
+        return nullptr;
+    }
+
+    uint64_t vertexSize = uint64_t(header.vertexCount) * sizeof(Vertex);
+    uint64_t indexSize = uint64_t(header.indexCount) * sizeof(uint32);
+    if (header.vertexOffset < sizeof(header) || header.vertexOffset + vertexSize > file.size()
+        || header.indexOffset < sizeof(header) || header.indexOffset + indexSize > file.size()) {
+        std::cout << "Mesh file " << path.string() << " is truncated" << std::endl;
+        return nullptr;
+    }
+
+    // Straight copies of the streams, Vertex is trivially copyable so assign is a memcpy
+    MeshData* data = new MeshData();
+    Vertex const* vertices = reinterpret_cast<Vertex const*>(file.data() + header.vertexOffset);
+    uint32 const* indices = reinterpret_cast<uint32 const*>(file.data() + header.indexOffset);
+    data->Vertices.assign(vertices, vertices + header.vertexCount);
+    data->Indices.assign(indices, indices + header.indexCount);
+    data->BoundingSphere = vec4(header.boundingSphere[0], header.boundingSphere[1], header.boundingSphere[2], header.boundingSphere[3]);
+
+    return data;
+
+}
+
+bool MeshFile::Write(std::filesystem::path const& path, MeshData const& data, uint32_t flags)
+{
+
+    PROFILE_FUNCTION();
+
+    MeshFileHeader header{};
+    header.magic = MeshFileHeader::MAGIC;
+    header.version = MeshFileHeader::VERSION;
+    header.flags = flags;
+    header.vertexStride = sizeof(Vertex);
+    header.vertexCount = static_cast<uint32_t>(data.Vertices.size());
+    header.indexCount = static_cast<uint32_t>(data.Indices.size());
+    header.vertexOffset = alignUp(sizeof(header));
+    header.indexOffset = alignUp(header.vertexOffset + data.Vertices.size() * sizeof(Vertex));
+
+    vec4 sphere = data.BoundingSphere ? *data.BoundingSphere : Mesh::ComputeBoundingSphere(data.Vertices);
+    std::memcpy(header.boundingSphere, &sphere, sizeof(header.boundingSphere));
+
+    vec3 minimum = data.Vertices.empty() ? vec3(0.0f) : data.Vertices[0].position;
+    vec3 maximum = minimum;
+    for (Vertex const& vertex : data.Vertices) {
+        minimum = min(minimum, vertex.position);
+        maximum = max(maximum, vertex.position);
+    }
+    std::memcpy(header.boundsMin, &minimum, sizeof(header.boundsMin));
+    std::memcpy(header.boundsMax, &maximum, sizeof(header.boundsMax));
+
+    std::filesystem::path temporaryPath = path;
+    temporaryPath += ".tmp";
+
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) return false;
+
+        static const char padding[STREAM_ALIGNMENT] = {};
+
+        file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        file.write(padding, static_cast<std::streamsize>(header.vertexOffset - sizeof(header)));
+        file.write(reinterpret_cast<char const*>(data.Vertices.data()), static_cast<std::streamsize>(data.Vertices.size() * sizeof(Vertex)));
+        file.write(padding, static_cast<std::streamsize>(header.indexOffset - header.vertexOffset - data.Vertices.size() * sizeof(Vertex)));
+        file.write(reinterpret_cast<char const*>(data.Indices.data()), static_cast<std::streamsize>(data.Indices.size() * sizeof(uint32)));
+
+        if (!file) return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error)
+    {
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+
+    return true;
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <filesystem>
+
+#include "Mesh.h"
+
+// Binary mesh container, written once from a source model and loaded without any
+// parsing: the file is mapped and both streams are copied as they are.
+//
+//   MeshFileHeader
+//   vertex stream   vertexCount * sizeof(Vertex), 16 bytes aligned
+//   index stream    indexCount * uint32, 16 bytes aligned
+//
+// Little endian, the layout of Vertex is the one of the vertex shader inputs.
+struct MeshFileHeader
+{
+    static constexpr uint32_t MAGIC = 0x48534D56; // "VMSH"
+    // Bump on any change of the header, of Vertex or of the import, older files are converted again.
+    // 2: the streams are ordered by MeshOptimizer
+    static constexpr uint32_t VERSION = 2;
+
+    enum Flags : uint32_t
+    {
+        INVERTED_V = 0x1,
+    };
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t flags;
+    uint32_t vertexStride;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    // Model space, center in xyz and radius in w, as Mesh::getBoundingSphere
+    float boundingSphere[4];
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+class MeshFile
+{
+public:
+    // Null when the file is missing, truncated, from another version or, when given, has other flags
+    static MeshData* Load(std::filesystem::path const& path, std::optional<uint32_t> expectedFlags = std::nullopt);
+    // Through a temporary file, a crash never leaves half a mesh behind
+    static bool Write(std::filesystem::path const& path, MeshData const& data, uint32_t flags);
+
+    static const inline wchar_t* EXTENSION = L".vmesh";
+};
@@ -0,0 +1,245 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "Profiler.h"
+
+MeshOptimizer::Stats MeshOptimizer::Analyze(MeshData const& data)
+{
+
+    Stats stats;
+    if (data.Indices.empty() || data.Vertices.empty()) return stats;
+
+    // Timestamp of the entry of every vertex, in the cache while less than CACHE_SIZE entries came after it
+    std::vector<uint32_t> entered(data.Vertices.size(), 0);
+    uint32_t misses = 0;
+
+    for (uint32 index : data.Indices)
+    {
+        if (index >= data.Vertices.size()) continue;
+
+        if (entered[index] == 0 || misses + 1 - entered[index] > CACHE_SIZE)
+        {
+            misses++;
+            entered[index] = misses;
+        }
+    }
+
+    stats.acmr = float(misses) / float(data.Indices.size() / 3);
+    stats.atvr = float(misses) / float(data.Vertices.size());
+    return stats;
+
+}
+
+void MeshOptimizer::Optimize(MeshData& data)
+{
+
+    PROFILE_FUNCTION();
+
+    if (data.Indices.size() < 3 || data.Vertices.empty()) return;
+
+    uint32_t vertexCount = static_cast<uint32_t>(data.Vertices.size());
+    if (std::any_of(data.Indices.begin(), data.Indices.end(), [vertexCount](uint32 index) { return index >= vertexCount; })) return;
+
+    std::vector<uint32_t> clusters;
+    std::vector<uint32> indices = Tipsify(data.Indices, vertexCount, clusters);
+    data.Indices = SortClusters(data, indices, clusters);
+
+    ReorderVertices(data);
+
+}
+
+std::vector<uint32> MeshOptimizer::Tipsify(std::vector<uint32> const& indices, uint32_t vertexCount, std::vector<uint32_t>& clusters)
+{
+
+    uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+    // Triangles around every vertex, and how many of them are not emitted yet
+    std::vector<uint32_t> live(vertexCount, 0);
+    for (uint32_t i = 0; i < triangleCount * 3; i++) live[indices[i]]++;
+
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    std::partial_sum(live.begin(), live.end(), offsets.begin() + 1);
+
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (uint32_t i = 0; i < triangleCount * 3; i++) adjacency[fill[indices[i]]++] = i / 3;
+
+    // Cache entry time of every vertex, a vertex is in the cache while time - entry <= CACHE_SIZE
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    uint32_t time = CACHE_SIZE + 1;
+
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    uint32_t cursor = 0;
+
+    std::vector<uint32> result;
+    result.reserve(triangleCount * 3);
+
+    // Every jump to a vertex outside the last triangles starts a cluster, the cache is cold there anyway
+    clusters.assign(1, 0);
+
+    int64_t fanning = 0;
+    while (fanning >= 0)
+    {
+        uint32_t vertex = static_cast<uint32_t>(fanning);
+        candidates.clear();
+
+        for (uint32_t k = offsets[vertex]; k < offsets[vertex + 1]; k++)
+        {
+            uint32_t triangle = adjacency[k];
+            if (emitted[triangle]) continue;
+            emitted[triangle] = 1;
+
+            for (uint32_t corner = 0; corner < 3; corner++)
+            {
+                uint32_t v = indices[triangle * 3 + corner];
+                result.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+
+                if (time - cacheTime[v] > CACHE_SIZE) cacheTime[v] = time++;
+            }
+        }
+
+        // Next fanning vertex: the oldest one still in the cache after its remaining triangles
+        fanning = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates)
+        {
+            if (live[v] == 0) continue;
+
+            int64_t priority = 0;
+            if (time - cacheTime[v] + 2 * live[v] <= CACHE_SIZE) priority = time - cacheTime[v];
+
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                fanning = v;
+            }
+        }
+
+        if (fanning >= 0) continue;
+
+        // Dead end: the last vertices used first, then the first vertex with triangles left
+        while (!deadEnd.empty() && fanning < 0)
+        {
+            uint32_t v = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[v] > 0) fanning = v;
+        }
+
+        while (fanning < 0 && cursor < vertexCount)
+        {
+            if (live[cursor] > 0) fanning = cursor;
+            else cursor++;
+        }
+
+        uint32_t emittedCount = static_cast<uint32_t>(result.size() / 3);
+        if (fanning >= 0 && emittedCount > clusters.back()) clusters.push_back(emittedCount);
+    }
+
+    return result;
+
+}
+
+std::vector<uint32> MeshOptimizer::SortClusters(MeshData const& data, std::vector<uint32> const& indices, std::vector<uint32_t> const& clusters)
+{
+
+    uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    if (clusters.size() < 2) return indices;
+
+    struct Cluster
+    {
+        uint32_t begin;
+        uint32_t end;
+        float sortKey;
+    };
+
+    // Area weighted centroid and normal of every cluster, the sum of the triangle normals
+    // of a cluster is its area weighted normal already
+    std::vector<vec3> centroids(clusters.size());
+    std::vector<vec3> normals(clusters.size());
+    vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+
+    std::vector<Cluster> sorted(clusters.size());
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        sorted[c].begin = clusters[c];
+        sorted[c].end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+        vec3 centroid(0.0f);
+        vec3 normal(0.0f);
+        float area = 0.0f;
+
+        for (uint32_t triangle = sorted[c].begin; triangle < sorted[c].end; triangle++)
+        {
+            vec3 const& a = data.Vertices[indices[triangle * 3 + 0]].position;
+            vec3 const& b = data.Vertices[indices[triangle * 3 + 1]].position;
+            vec3 const& d = data.Vertices[indices[triangle * 3 + 2]].position;
+
+            vec3 areaNormal = cross(b - a, d - a);
+            float triangleArea = length(areaNormal) * 0.5f;
+
+            centroid += (a + b + d) * (triangleArea / 3.0f);
+            normal += areaNormal;
+            area += triangleArea;
+        }
+
+        meshCentroid += centroid;
+        meshArea += area;
+
+        centroids[c] = area > 0.0f ? centroid / area : centroid;
+        normals[c] = length(normal) > 0.0f ? normalize(normal) : normal;
+    }
+
+    if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+    // The clusters facing out and far from the center hide the others, they go first
+    for (size_t c = 0; c < clusters.size(); c++) {
+        sorted[c].sortKey = dot(normals[c], centroids[c] - meshCentroid);
+    }
+
+    std::stable_sort(sorted.begin(), sorted.end(), [](Cluster const& a, Cluster const& b) { return a.sortKey > b.sortKey; });
+
+    std::vector<uint32> result;
+    result.reserve(indices.size());
+    for (Cluster const& cluster : sorted) {
+        result.insert(result.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+    }
+
+    return result;
+
+}
+
+void MeshOptimizer::ReorderVertices(MeshData& data)
+{
+
+    constexpr uint32_t UNUSED = UINT32_MAX;
+
+    std::vector<uint32_t> remap(data.Vertices.size(), UNUSED);
+    std::vector<Vertex> vertices;
+    vertices.reserve(data.Vertices.size());
+
+    for (uint32& index : data.Indices)
+    {
+        if (remap[index] == UNUSED)
+        {
+            remap[index] = static_cast<uint32_t>(vertices.size());
+            vertices.push_back(data.Vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    // Nothing draws them, they only keep their place in the buffer
+    for (size_t vertex = 0; vertex < data.Vertices.size(); vertex++) {
+        if (remap[vertex] == UNUSED) vertices.push_back(data.Vertices[vertex]);
+    }
+
+    data.Vertices.swap(vertices);
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Mesh.h"
+
+// Reorders the triangles and vertices of a mesh for the GPU, without changing what
+// is drawn. Applied once when a model is imported, the .vmesh keeps the result.
+//  - triangles for the post-transform vertex cache, with Tipsify (Sander et al. 2007)
+//  - the clusters Tipsify produces sorted outward-facing first, to reduce overdraw
+//  - vertices in the order the triangles first use them, for the vertex fetch
+class MeshOptimizer
+{
+public:
+    struct Stats
+    {
+        // Average cache miss ratio: transformed vertices per triangle, 0.5 at best on a grid
+        float acmr = 0.0f;
+        // Average transform to vertex ratio: transformed vertices per vertex, 1 at best
+        float atvr = 0.0f;
+    };
+
+    // FIFO cache of CACHE_SIZE entries, the same the triangles are ordered for
+    static Stats Analyze(MeshData const& data);
+    static void Optimize(MeshData& data);
+
+    // Entries of the post-transform cache Tipsify aims at, small enough for every GPU
+    static constexpr uint32_t CACHE_SIZE = 16;
+
+private:
+    // Returns the triangles in cache order and the first triangle of every cluster
+    static std::vector<uint32> Tipsify(std::vector<uint32> const& indices, uint32_t vertexCount, std::vector<uint32_t>& clusters);
+    static std::vector<uint32> SortClusters(MeshData const& data, std::vector<uint32> const& indices, std::vector<uint32_t> const& clusters);
+    static void ReorderVertices(MeshData& data);
+};
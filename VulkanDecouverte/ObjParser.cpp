@@ -0,0 +1,368 @@
+#include "ObjParser.h"
+
+#include <charconv>
+#include <cstring>
+
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "Profiler.h"
+
+namespace
+{
+    constexpr int32_t MISSING = INT32_MIN;
+
+    enum RelativeBits : uint8_t
+    {
+        RELATIVE_POSITION = 0x1,
+        RELATIVE_TEXCOORDS = 0x2,
+        RELATIVE_NORMAL = 0x4,
+    };
+
+    // Zero based, or counted from the end of the chunk data when the matching bit is set:
+    // a negative index is resolved once the number of elements of the previous chunks is known
+    struct Corner
+    {
+        int32_t position;
+        int32_t texCoords;
+        int32_t normal;
+        uint8_t relative;
+    };
+
+    struct Chunk
+    {
+        char const* begin;
+        char const* end;
+
+        std::vector<vec3> positions;
+        std::vector<vec2> texCoords;
+        std::vector<vec3> normals;
+        std::vector<Corner> corners;
+        std::vector<uint32_t> faceSizes;
+    };
+
+    char const* skipSpaces(char const* p, char const* end)
+    {
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+        return p;
+    }
+
+    char const* skipToken(char const* p, char const* end)
+    {
+        while (p < end && *p != ' ' && *p != '\t') p++;
+        return p;
+    }
+
+    template<typename T>
+    bool parseNumber(char const*& p, char const* end, T& value)
+    {
+        p = skipSpaces(p, end);
+        // from_chars refuses the sign some exporters write
+        if (p < end && *p == '+') p++;
+
+        std::from_chars_result result = std::from_chars(p, end, value);
+        if (result.ec != std::errc()) return false;
+
+        p = result.ptr;
+        return true;
+    }
+
+    // One based, negative from the end of what was read so far, 0 is not an index
+    bool parseIndex(char const*& p, char const* end, uint32_t count, int32_t& index, uint8_t& relative, uint8_t bit)
+    {
+        int32_t value;
+        std::from_chars_result result = std::from_chars(p, end, value);
+        if (result.ec != std::errc() || value == 0) return false;
+
+        p = result.ptr;
+        if (value > 0) {
+            index = value - 1;
+        } else {
+            index = static_cast<int32_t>(count) + value;
+            relative |= bit;
+        }
+        return true;
+    }
+
+    void parseFace(char const* p, char const* end, Chunk& chunk)
+    {
+
+        uint32_t size = 0;
+
+        while ((p = skipSpaces(p, end)) < end)
+        {
+            Corner corner{ MISSING, MISSING, MISSING, 0 };
+
+            if (!parseIndex(p, end, static_cast<uint32_t>(chunk.positions.size()), corner.position, corner.relative, RELATIVE_POSITION))
+            {
+                p = skipToken(p, end);
+                continue;
+            }
+
+            if (p < end && *p == '/')
+            {
+                p++;
+                if (p < end && *p != '/') {
+                    parseIndex(p, end, static_cast<uint32_t>(chunk.texCoords.size()), corner.texCoords, corner.relative, RELATIVE_TEXCOORDS);
+                }
+                if (p < end && *p == '/')
+                {
+                    p++;
+                    parseIndex(p, end, static_cast<uint32_t>(chunk.normals.size()), corner.normal, corner.relative, RELATIVE_NORMAL);
+                }
+            }
+
+            p = skipToken(p, end);
+            chunk.corners.push_back(corner);
+            size++;
+        }
+
+        // Points and lines have no triangle
+        if (size < 3) {
+            chunk.corners.resize(chunk.corners.size() - size);
+        } else {
+            chunk.faceSizes.push_back(size);
+        }
+
+    }
+
+    void parseChunk(Chunk& chunk, bool invertV)
+    {
+
+        char const* p = chunk.begin;
+
+        while (p < chunk.end)
+        {
+            char const* lineEnd = static_cast<char const*>(std::memchr(p, '\n', chunk.end - p));
+            if (lineEnd == nullptr) lineEnd = chunk.end;
+
+            char const* next = lineEnd < chunk.end ? lineEnd + 1 : chunk.end;
+            if (lineEnd > p && lineEnd[-1] == '\r') lineEnd--;
+
+            p = skipSpaces(p, lineEnd);
+            size_t length = lineEnd - p;
+
+            if (length >= 2 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+            {
+                vec3 position(0.0f);
+                char const* cursor = p + 1;
+                parseNumber(cursor, lineEnd, position.x) && parseNumber(cursor, lineEnd, position.y) && parseNumber(cursor, lineEnd, position.z);
+                chunk.positions.push_back(position);
+            }
+            else if (length >= 3 && p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t'))
+            {
+                vec3 normal(0.0f);
+                char const* cursor = p + 2;
+                parseNumber(cursor, lineEnd, normal.x) && parseNumber(cursor, lineEnd, normal.y) && parseNumber(cursor, lineEnd, normal.z);
+                chunk.normals.push_back(normal);
+            }
+            else if (length >= 3 && p[0] == 'v' && p[1] == 't' && (p[2] == ' ' || p[2] == '\t'))
+            {
+                vec2 texCoords(0.0f);
+                char const* cursor = p + 2;
+                parseNumber(cursor, lineEnd, texCoords.x) && parseNumber(cursor, lineEnd, texCoords.y);
+                // Flip V to match DirectX/OpenGL convention
+                if (invertV) texCoords.y = 1.0f - texCoords.y;
+                chunk.texCoords.push_back(texCoords);
+            }
+            else if (length >= 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+            {
+                parseFace(p + 1, lineEnd, chunk);
+            }
+
+            p = next;
+        }
+
+    }
+
+    // Open addressing on the resolved v/vt/vn triplet, grown at half load
+    class VertexTable
+    {
+    public:
+        explicit VertexTable(size_t expected)
+        {
+            size_t capacity = 1024;
+            while (capacity < expected * 2) capacity *= 2;
+            m_slots.assign(capacity, Slot{});
+        }
+
+        // Index of the vertex for the triplet, added is true when it has to be created as count
+        uint32_t findOrAdd(uint32_t position, uint32_t texCoords, uint32_t normal, uint32_t count, bool& added)
+        {
+
+            if ((m_used + 1) * 2 > m_slots.size()) grow();
+
+            size_t mask = m_slots.size() - 1;
+            for (size_t slot = hash(position, texCoords, normal) & mask;; slot = (slot + 1) & mask)
+            {
+                Slot& entry = m_slots[slot];
+                if (entry.vertex == EMPTY)
+                {
+                    entry = { position, texCoords, normal, count };
+                    m_used++;
+                    added = true;
+                    return count;
+                }
+                if (entry.position == position && entry.texCoords == texCoords && entry.normal == normal)
+                {
+                    added = false;
+                    return entry.vertex;
+                }
+            }
+
+        }
+
+    private:
+        static constexpr uint32_t EMPTY = UINT32_MAX;
+
+        struct Slot
+        {
+            uint32_t position = 0;
+            uint32_t texCoords = 0;
+            uint32_t normal = 0;
+            uint32_t vertex = EMPTY;
+        };
+
+        std::vector<Slot> m_slots;
+        size_t m_used = 0;
+
+        static size_t hash(uint32_t position, uint32_t texCoords, uint32_t normal)
+        {
+            uint64_t key = (uint64_t(position) * 0x9E3779B97F4A7C15ull) ^ (uint64_t(texCoords) * 0xC2B2AE3D27D4EB4Full) ^ (uint64_t(normal) * 0x165667B19E3779F9ull);
+            return static_cast<size_t>(key ^ (key >> 32));
+        }
+
+        void grow()
+        {
+
+            std::vector<Slot> slots(m_slots.size() * 2);
+            size_t mask = slots.size() - 1;
+
+            for (Slot const& entry : m_slots)
+            {
+                if (entry.vertex == EMPTY) continue;
+
+                size_t slot = hash(entry.position, entry.texCoords, entry.normal) & mask;
+                while (slots[slot].vertex != EMPTY) slot = (slot + 1) & mask;
+                slots[slot] = entry;
+            }
+
+            m_slots.swap(slots);
+
+        }
+    };
+
+    uint32_t resolve(int32_t index, bool relative, uint32_t base)
+    {
+        if (index == MISSING) return UINT32_MAX;
+        return static_cast<uint32_t>(relative ? index + static_cast<int32_t>(base) : index);
+    }
+}
+
+MeshData* ObjParser::Parse(std::filesystem::path const& path, bool invertV, JobSystem& jobs)
+{
+
+    PROFILE_FUNCTION();
+
+    MeshData* data = new MeshData();
+
+    MappedFile file(path);
+    if (file.size() == 0) return data;
+
+    // Cut at the first line end after every CHUNK_SIZE bytes, a line is never split
+    std::vector<Chunk> chunks;
+    char const* fileEnd = file.data() + file.size();
+    for (char const* begin = file.data(); begin < fileEnd;)
+    {
+        char const* end = begin + std::min(CHUNK_SIZE, static_cast<size_t>(fileEnd - begin));
+        if (end < fileEnd)
+        {
+            char const* lineEnd = static_cast<char const*>(std::memchr(end, '\n', fileEnd - end));
+            end = lineEnd != nullptr ? lineEnd + 1 : fileEnd;
+        }
+
+        chunks.push_back(Chunk{ begin, end });
+        begin = end;
+    }
+
+    {
+        PROFILE_SCOPE("Parse chunks");
+        jobs.parallelFor(static_cast<uint32_t>(chunks.size()), 1, [&chunks, invertV](uint32_t begin, uint32_t end) {
+            for (uint32_t chunk = begin; chunk < end; chunk++) {
+                parseChunk(chunks[chunk], invertV);
+            }
+        });
+    }
+
+    PROFILE_SCOPE("Build vertices");
+
+    std::vector<vec3> positions;
+    std::vector<vec2> texCoords;
+    std::vector<vec3> normals;
+    size_t triangleCount = 0;
+    for (Chunk const& chunk : chunks)
+    {
+        positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+        texCoords.insert(texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+        normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+        for (uint32_t size : chunk.faceSizes) triangleCount += size - 2;
+    }
+
+    // Closed meshes share each position between a few corners
+    VertexTable table(positions.size());
+    data->Vertices.reserve(positions.size());
+    data->Indices.reserve(triangleCount * 3);
+
+    uint32_t positionBase = 0;
+    uint32_t texCoordsBase = 0;
+    uint32_t normalBase = 0;
+    std::vector<uint32_t> face;
+
+    for (Chunk& chunk : chunks)
+    {
+        Corner const* corner = chunk.corners.data();
+
+        for (uint32_t size : chunk.faceSizes)
+        {
+            face.clear();
+
+            for (uint32_t i = 0; i < size; i++, corner++)
+            {
+                uint32_t position = resolve(corner->position, corner->relative & RELATIVE_POSITION, positionBase);
+                uint32_t texCoord = resolve(corner->texCoords, corner->relative & RELATIVE_TEXCOORDS, texCoordsBase);
+                uint32_t normal = resolve(corner->normal, corner->relative & RELATIVE_NORMAL, normalBase);
+
+                bool added;
+                uint32_t vertex = table.findOrAdd(position, texCoord, normal, static_cast<uint32_t>(data->Vertices.size()), added);
+                if (added)
+                {
+                    // Out of range indices keep the default attribute, as the previous loader did
+                    Vertex newVertex;
+                    if (position < positions.size()) newVertex.position = positions[position];
+                    if (normal < normals.size()) newVertex.normal = normals[normal];
+                    if (texCoord < texCoords.size()) newVertex.texCoords = texCoords[texCoord];
+                    data->Vertices.push_back(newVertex);
+                }
+
+                face.push_back(vertex);
+            }
+
+            // Fan around the first corner, same triangles as before for quads
+            for (uint32_t i = 1; i + 1 < size; i++)
+            {
+                data->Indices.push_back(face[0]);
+                data->Indices.push_back(face[i]);
+                data->Indices.push_back(face[i + 1]);
+            }
+        }
+
+        positionBase += static_cast<uint32_t>(chunk.positions.size());
+        texCoordsBase += static_cast<uint32_t>(chunk.texCoords.size());
+        normalBase += static_cast<uint32_t>(chunk.normals.size());
+
+        // The chunk is not needed anymore, give its memory back before the next one grows the output
+        chunk = Chunk{};
+    }
+
+    return data;
+
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <filesystem>
+
+#include "Mesh.h"
+
+class JobSystem;
+
+// Wavefront OBJ reader. The file is mapped and split at line boundaries into chunks
+// parsed in parallel, then the chunks are stitched together in order: positions,
+// texture coordinates and normals are concatenated, the face corners are resolved
+// against them and deduplicated on their v/vt/vn triplet. Faces of any size are
+// triangulated as fans. Only v, vt, vn and f are read, the rest is skipped.
+class ObjParser
+{
+public:
+    // Never null, an empty MeshData when the file cannot be read
+    static MeshData* Parse(std::filesystem::path const& path, bool invertV, JobSystem& jobs);
+
+    // Bytes per chunk, large enough that a job is worth scheduling
+    static constexpr size_t CHUNK_SIZE = 1 << 20;
+};
@@ -0,0 +1,127 @@
+#include "PipelineCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "Profiler.h"
+
+PipelineCache::PipelineCache(VkDevice device, VkPhysicalDeviceProperties const& properties, std::string path)
+    : m_device(device), m_path(std::move(path)), m_properties(properties)
+{
+
+    PROFILE_FUNCTION();
+
+    std::vector<char> data = readFile();
+    if (!data.empty() && !isCompatible(data)) {
+        std::cout << "Pipeline cache " << m_path << " comes from another device or driver, ignored" << std::endl;
+        data.clear();
+    }
+
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = data.size();
+    createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    if (vkCreatePipelineCache(m_device, &createInfo, nullptr, &m_cache) != VK_SUCCESS)
+    {
+        // The driver may still refuse data it does not like, start empty then
+        createInfo.initialDataSize = 0;
+        createInfo.pInitialData = nullptr;
+        data.clear();
+
+        if (vkCreatePipelineCache(m_device, &createInfo, nullptr, &m_cache) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline cache!");
+        }
+    }
+
+    m_loaded = !data.empty();
+
+}
+
+PipelineCache::~PipelineCache()
+{
+
+    save();
+    vkDestroyPipelineCache(m_device, m_cache, nullptr);
+
+}
+
+VkPipelineCache PipelineCache::getHandle() const
+{
+    return m_cache;
+}
+
+bool PipelineCache::wasLoaded() const
+{
+    return m_loaded;
+}
+
+void PipelineCache::save()
+{
+
+    PROFILE_FUNCTION();
+
+    size_t size = 0;
+    if (vkGetPipelineCacheData(m_device, m_cache, &size, nullptr) != VK_SUCCESS || size == 0) return;
+
+    std::vector<char> data(size);
+    if (vkGetPipelineCacheData(m_device, m_cache, &size, data.data()) != VK_SUCCESS) return;
+
+    // Written aside and renamed, a crash while saving does not leave half a cache behind
+    std::string temporaryPath = m_path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cout << "Failed to write the pipeline cache to " << temporaryPath << std::endl;
+            return;
+        }
+        file.write(data.data(), static_cast<std::streamsize>(size));
+    }
+
+    std::remove(m_path.c_str());
+    std::rename(temporaryPath.c_str(), m_path.c_str());
+
+}
+
+std::vector<char> PipelineCache::readFile() const
+{
+
+    std::ifstream file(m_path, std::ios::ate | std::ios::binary);
+    if (!file.is_open()) return {};
+
+    size_t fileSize = (size_t) file.tellg();
+    std::vector<char> buffer(fileSize);
+
+    file.seekg(0);
+    file.read(buffer.data(), fileSize);
+
+    return buffer;
+
+}
+
+bool PipelineCache::isCompatible(std::vector<char> const& data) const
+{
+
+    // VkPipelineCacheHeaderVersionOne, read field by field, the data has no alignment guarantee
+    uint32_t headerSize;
+    uint32_t headerVersion;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint8_t cacheUUID[VK_UUID_SIZE];
+
+    if (data.size() < 16 + VK_UUID_SIZE) return false;
+
+    std::memcpy(&headerSize, data.data(), 4);
+    std::memcpy(&headerVersion, data.data() + 4, 4);
+    std::memcpy(&vendorID, data.data() + 8, 4);
+    std::memcpy(&deviceID, data.data() + 12, 4);
+    std::memcpy(cacheUUID, data.data() + 16, VK_UUID_SIZE);
+
+    return headerSize >= 16 + VK_UUID_SIZE && headerSize <= data.size()
+        && headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+        && vendorID == m_properties.vendorID
+        && deviceID == m_properties.deviceID
+        && std::memcmp(cacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+
+}
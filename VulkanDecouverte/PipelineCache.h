@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+
+#include "framework.h"
+
+// One VkPipelineCache for every pipeline of the application, loaded from disk at
+// startup and written back on shutdown. A file made by another driver or device
+// is ignored, the cache then starts empty.
+class PipelineCache
+{
+public:
+    PipelineCache(VkDevice device, VkPhysicalDeviceProperties const& properties, std::string path = DEFAULT_PATH);
+    // Saves the cache
+    ~PipelineCache();
+
+    PipelineCache(PipelineCache const&) = delete;
+    PipelineCache& operator=(PipelineCache const&) = delete;
+
+    VkPipelineCache getHandle() const;
+    // True when the file was accepted, the pipelines already built in a previous run are then cheap
+    bool wasLoaded() const;
+
+    void save();
+
+    static constexpr char const* DEFAULT_PATH = "pipeline_cache.bin";
+
+private:
+    VkDevice m_device;
+    VkPipelineCache m_cache = VK_NULL_HANDLE;
+    std::string m_path;
+    bool m_loaded = false;
+
+    VkPhysicalDeviceProperties m_properties;
+
+    std::vector<char> readFile() const;
+    // Header check from the Vulkan spec, the driver is not required to reject foreign data
+    bool isCompatible(std::vector<char> const& data) const;
+};
@@ -0,0 +1,247 @@
+#include "PipelineRegistry.h"
+
+#include "Application.h"
+#include "RenderPipeline.h"
+
+// FNV-1a, the descriptions are hashed field by field so the padding of the Vulkan structs never counts
+static void hashBytes(size_t& hash, void const* data, size_t size)
+{
+
+    unsigned char const* bytes = static_cast<unsigned char const*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+
+}
+
+template<typename T>
+static void hashValue(size_t& hash, T const& value)
+{
+    hashBytes(hash, &value, sizeof(T));
+}
+
+bool ShaderStage::operator==(ShaderStage const& other) const
+{
+    return path == other.path && type == other.type && defines == other.defines;
+}
+
+size_t PipelineDescription::hash() const
+{
+
+    size_t hash = 14695981039346656037ull;
+
+    for (ShaderStage const& shader : shaders)
+    {
+        hashBytes(hash, shader.path.data(), shader.path.size());
+        hashValue(hash, shader.type);
+        for (auto const& [name, value] : shader.defines)
+        {
+            hashBytes(hash, name.data(), name.size());
+            hashBytes(hash, value.data(), value.size());
+        }
+    }
+
+    for (VkVertexInputBindingDescription const& binding : vertexBindings)
+    {
+        hashValue(hash, binding.binding);
+        hashValue(hash, binding.stride);
+        hashValue(hash, binding.inputRate);
+    }
+
+    for (VkVertexInputAttributeDescription const& attribute : vertexAttributes)
+    {
+        hashValue(hash, attribute.location);
+        hashValue(hash, attribute.binding);
+        hashValue(hash, attribute.format);
+        hashValue(hash, attribute.offset);
+    }
+
+    hashValue(hash, topology);
+    hashValue(hash, polygonMode);
+    hashValue(hash, cullMode);
+    hashValue(hash, frontFace);
+    hashValue(hash, depthTest);
+    hashValue(hash, depthWrite);
+    hashValue(hash, depthCompare);
+    hashValue(hash, blend);
+    hashValue(hash, srcColorBlend);
+    hashValue(hash, dstColorBlend);
+    hashValue(hash, colorBlendOp);
+    hashValue(hash, srcAlphaBlend);
+    hashValue(hash, dstAlphaBlend);
+    hashValue(hash, alphaBlendOp);
+    hashValue(hash, colorFormat);
+    hashValue(hash, renderPass);
+    hashValue(hash, subpass);
+    hashValue(hash, layout);
+
+    return hash;
+
+}
+
+bool PipelineDescription::operator==(PipelineDescription const& other) const
+{
+
+    if (shaders != other.shaders) return false;
+
+    if (vertexBindings.size() != other.vertexBindings.size()) return false;
+    for (size_t i = 0; i < vertexBindings.size(); i++)
+    {
+        VkVertexInputBindingDescription const& a = vertexBindings[i];
+        VkVertexInputBindingDescription const& b = other.vertexBindings[i];
+        if (a.binding != b.binding || a.stride != b.stride || a.inputRate != b.inputRate) return false;
+    }
+
+    if (vertexAttributes.size() != other.vertexAttributes.size()) return false;
+    for (size_t i = 0; i < vertexAttributes.size(); i++)
+    {
+        VkVertexInputAttributeDescription const& a = vertexAttributes[i];
+        VkVertexInputAttributeDescription const& b = other.vertexAttributes[i];
+        if (a.location != b.location || a.binding != b.binding || a.format != b.format || a.offset != b.offset) return false;
+    }
+
+    return topology == other.topology
+        && polygonMode == other.polygonMode
+        && cullMode == other.cullMode
+        && frontFace == other.frontFace
+        && depthTest == other.depthTest
+        && depthWrite == other.depthWrite
+        && depthCompare == other.depthCompare
+        && blend == other.blend
+        && srcColorBlend == other.srcColorBlend
+        && dstColorBlend == other.dstColorBlend
+        && colorBlendOp == other.colorBlendOp
+        && srcAlphaBlend == other.srcAlphaBlend
+        && dstAlphaBlend == other.dstAlphaBlend
+        && alphaBlendOp == other.alphaBlendOp
+        && colorFormat == other.colorFormat
+        && renderPass == other.renderPass
+        && subpass == other.subpass
+        && layout == other.layout;
+
+}
+
+PipelineRegistry::~PipelineRegistry()
+{
+
+    for (auto& [description, entry] : m_pipelines) {
+        Application::getInstance()->getJobSystem().wait(*entry.jobs);
+    }
+
+    for (RetiredPipeline const& retired : m_retired) {
+        vkDestroyPipeline(Application::getInstance()->getDevice(), retired.pipeline, nullptr);
+    }
+
+}
+
+RenderPipeline& PipelineRegistry::get(PipelineDescription const& description)
+{
+
+    RenderPipeline* pending = nullptr;
+    JobSystem::Counter* jobs = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto found = m_pipelines.find(description);
+        if (found == m_pipelines.end())
+        {
+            // Compiled below without the lock, the other requests and the frame boundary
+            // never wait for the driver. Drawn with nothing until then, like getAsync
+            Entry entry;
+            entry.pipeline = std::make_unique<RenderPipeline>(description, nullptr);
+            found = m_pipelines.emplace(description, std::move(entry)).first;
+        }
+        else if (found->second.pipeline->isReady())
+        {
+            return *found->second.pipeline;
+        }
+
+        pending = found->second.pipeline.get();
+        jobs = found->second.jobs.get();
+    }
+
+    // Requested with getAsync earlier, only its own compilation is waited for, the
+    // waiting thread runs other jobs meanwhile
+    Application::getInstance()->getJobSystem().wait(*jobs);
+
+    // First compilation, or a failed one tried again, here the error reaches the caller.
+    // Two threads asking at once only compile once, see RenderPipeline::compile
+    pending->compile();
+    return *pending;
+
+}
+
+RenderPipeline& PipelineRegistry::getAsync(PipelineDescription const& description, RenderPipeline* fallback)
+{
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto found = m_pipelines.find(description);
+    if (found != m_pipelines.end()) return *found->second.pipeline;
+
+    Entry entry;
+    entry.pipeline = std::make_unique<RenderPipeline>(description, fallback);
+    RenderPipeline* result = entry.pipeline.get();
+    JobSystem::Counter* jobs = entry.jobs.get();
+    m_pipelines.emplace(description, std::move(entry));
+
+    Application::getInstance()->getJobSystem().schedule([result]() { result->compileNoThrow(); }, jobs);
+
+    return *result;
+
+}
+
+void PipelineRegistry::reload(std::string const& shaderPath)
+{
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto& [description, entry] : m_pipelines)
+    {
+        if (!entry.pipeline->usesShader(shaderPath)) continue;
+
+        RenderPipeline* rebuilt = entry.pipeline.get();
+        Application::getInstance()->getJobSystem().schedule([rebuilt]() { rebuilt->rebuild(); }, entry.jobs.get());
+    }
+
+}
+
+void PipelineRegistry::swapReloaded(uint32_t framesInFlight)
+{
+
+    // Every frame that could still use a retired pipeline was waited for
+    for (size_t i = 0; i < m_retired.size();)
+    {
+        if (--m_retired[i].framesLeft == 0)
+        {
+            vkDestroyPipeline(Application::getInstance()->getDevice(), m_retired[i].pipeline, nullptr);
+            m_retired[i] = m_retired.back();
+            m_retired.pop_back();
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto& [description, entry] : m_pipelines)
+    {
+        VkPipeline retired;
+        if (entry.pipeline->swapRebuilt(retired) && retired != VK_NULL_HANDLE) {
+            m_retired.push_back({ retired, framesInFlight });
+        }
+    }
+
+}
+
+size_t PipelineRegistry::size() const
+{
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pipelines.size();
+
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "framework.h"
+
+#include "JobSystem.h"
+#include "Shader.h"
+
+class RenderPipeline;
+
+struct ShaderStage
+{
+    // Relative to Shader::SHADER_FOLDER
+    std::string path;
+    Shader::Type type;
+    // Only for GLSL sources, every set of defines is its own pipeline
+    ShaderDefines defines;
+
+    bool operator==(ShaderStage const& other) const;
+};
+
+// Everything a graphics pipeline is built from. The defaults are the state every
+// pipeline of the renderer used so far, RenderContext::getPipelineDescription
+// fills the target dependent part.
+struct PipelineDescription
+{
+    std::vector<ShaderStage> shaders;
+
+    std::vector<VkVertexInputBindingDescription> vertexBindings;
+    std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+    VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+    bool depthTest = true;
+    bool depthWrite = true;
+    VkCompareOp depthCompare = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+    bool blend = true;
+    VkBlendFactor srcColorBlend = VK_BLEND_FACTOR_SRC_ALPHA;
+    VkBlendFactor dstColorBlend = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    VkBlendOp colorBlendOp = VK_BLEND_OP_ADD;
+    VkBlendFactor srcAlphaBlend = VK_BLEND_FACTOR_ONE;
+    VkBlendFactor dstAlphaBlend = VK_BLEND_FACTOR_ZERO;
+    VkBlendOp alphaBlendOp = VK_BLEND_OP_ADD;
+
+    VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    uint32_t subpass = 0;
+    // Reflected from the shaders when left null
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+
+    size_t hash() const;
+    bool operator==(PipelineDescription const& other) const;
+};
+
+// Pipelines by description. Asking twice for the same state gives the same pipeline,
+// the driver only compiles the first request. Owned by a render context, the
+// pipelines live as long as it does.
+// getAsync compiles on the job system instead of the calling thread, the pipeline
+// it returns can be drawn with right away: RenderContext resolves it to its fallback,
+// or skips the draws, until the compilation is done.
+class PipelineRegistry
+{
+public:
+    PipelineRegistry() = default;
+    // Waits for the compilations still running
+    ~PipelineRegistry();
+
+    PipelineRegistry(PipelineRegistry const&) = delete;
+    PipelineRegistry& operator=(PipelineRegistry const&) = delete;
+
+    // Safe from any thread. Compiles on the calling thread, or waits for a pending one
+    RenderPipeline& get(PipelineDescription const& description);
+    // Returns at once. The fallback has to outlive the pipeline, usually a ready
+    // pipeline of the same registry with compatible inputs
+    RenderPipeline& getAsync(PipelineDescription const& description, RenderPipeline* fallback = nullptr);
+
+    // Rebuild on the job system every pipeline using the shader, path relative to the shader folder
+    void reload(std::string const& shaderPath);
+    // At a frame boundary, once the frame slot fence was waited for: the rebuilt pipelines
+    // take over and the ones they replaced are destroyed framesInFlight boundaries later
+    void swapReloaded(uint32_t framesInFlight);
+
+    size_t size() const;
+
+private:
+    struct DescriptionHash
+    {
+        size_t operator()(PipelineDescription const& description) const { return description.hash(); }
+    };
+
+    struct Entry
+    {
+        std::unique_ptr<RenderPipeline> pipeline;
+        // Compilation and rebuilds of this pipeline running on the job system, so get
+        // only waits for the pipeline it returns
+        std::unique_ptr<JobSystem::Counter> jobs = std::make_unique<JobSystem::Counter>();
+    };
+
+    mutable std::mutex m_mutex;
+    // Entries are never removed, a pipeline and its counter keep their address
+    std::unordered_map<PipelineDescription, Entry, DescriptionHash> m_pipelines;
+
+    struct RetiredPipeline
+    {
+        VkPipeline pipeline;
+        uint32_t framesLeft;
+    };
+
+    // Only touched at frame boundaries
+    std::vector<RetiredPipeline> m_retired;
+};
@@ -1,24 +1,249 @@
 ﻿#include "Profiler.h"
 
-#define PROFILER_ENABLE
+#include <array>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
-Profiler::~Profiler()
+namespace
 {
-    delete mTask;
+
+struct ProfileEvent
+{
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+};
+
+// Single producer (the owning thread), single consumer (the flush)
+struct ThreadBuffer
+{
+    static constexpr uint64_t CAPACITY = 1 << 14;
+
+    std::array<ProfileEvent, CAPACITY> events;
+    std::atomic<uint64_t> head = 0;
+    std::atomic<uint64_t> tail = 0;
+    std::atomic<uint64_t> dropped = 0;
+
+    uint32_t threadId = 0;
+    std::string threadName;
+    bool nameWritten = false;
+};
+
+struct ProfilerState
+{
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+    // Buffers are never released so a thread that exits can still be flushed
+    std::mutex buffersMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+    std::mutex flushMutex;
+    std::ofstream file;
+    bool firstEvent = true;
+
+    std::thread flushThread;
+    std::mutex stopMutex;
+    std::condition_variable stopCondition;
+    bool stopRequested = false;
+};
+
+ProfilerState& state()
+{
+    static ProfilerState instance;
+    return instance;
 }
 
-void Profiler::NewTask(std::string name)
+ThreadBuffer& threadBuffer()
 {
-#ifdef PROFILER_ENABLE
-    mTask->name = name;
-    mTask->mStart = std::chrono::high_resolution_clock::now();
-#endif
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (buffer == nullptr)
+    {
+        ProfilerState& profiler = state();
+        std::lock_guard<std::mutex> lock(profiler.buffersMutex);
+
+        profiler.buffers.push_back(std::make_unique<ThreadBuffer>());
+        buffer = profiler.buffers.back().get();
+        buffer->threadId = static_cast<uint32_t>(profiler.buffers.size());
+        buffer->threadName = "Thread " + std::to_string(buffer->threadId);
+    }
+    return *buffer;
 }
 
-void Profiler::EndTask()
+void writeEscaped(std::ostream& out, const char* text)
 {
-#ifdef PROFILER_ENABLE
-    auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - mTask->mStart).count();
-    printf("[PROFILER] \033[31m Your task : %s took %lld nanoseconds | %f seconds \033[0m\n", mTask->name.c_str(), duration, duration / 1000000000.0f);
-#endif
+    for (const char* c = text; *c != '\0'; c++)
+    {
+        if (*c == '"' || *c == '\\') out << '\\';
+        out << *c;
+    }
+}
+
+void writeSeparator(ProfilerState& profiler)
+{
+    if (!profiler.firstEvent) profiler.file << ",\n";
+    profiler.firstEvent = false;
+}
+
+}
+
+void Profiler::Start(std::string const& tracePath, uint32_t flushIntervalMs)
+{
+
+    if (IsCapturing()) return;
+
+    ProfilerState& profiler = state();
+
+    {
+        std::lock_guard<std::mutex> lock(profiler.flushMutex);
+
+        profiler.file.open(tracePath, std::ios::trunc);
+        if (!profiler.file.is_open())
+        {
+            std::cout << "[PROFILER] failed to open trace " << tracePath << std::endl;
+            return;
+        }
+
+        // JSON array format, the closing bracket is optional so a trace cut by a crash still loads
+        profiler.file << "[\n";
+        profiler.firstEvent = true;
+
+        std::lock_guard<std::mutex> buffersLock(profiler.buffersMutex);
+        for (auto& buffer : profiler.buffers)
+        {
+            buffer->tail.store(buffer->head.load(std::memory_order_acquire), std::memory_order_release);
+            buffer->nameWritten = false;
+        }
+    }
+
+    profiler.stopRequested = false;
+    sCapturing.store(true, std::memory_order_release);
+
+    profiler.flushThread = std::thread([flushIntervalMs]() {
+        ProfilerState& profiler = state();
+        std::unique_lock<std::mutex> lock(profiler.stopMutex);
+        while (!profiler.stopCondition.wait_for(lock, std::chrono::milliseconds(flushIntervalMs), [&profiler]() { return profiler.stopRequested; }))
+        {
+            lock.unlock();
+            Flush();
+            lock.lock();
+        }
+    });
+
+}
+
+void Profiler::Stop()
+{
+
+    if (!IsCapturing()) return;
+
+    ProfilerState& profiler = state();
+    sCapturing.store(false, std::memory_order_release);
+
+    {
+        std::lock_guard<std::mutex> lock(profiler.stopMutex);
+        profiler.stopRequested = true;
+    }
+    profiler.stopCondition.notify_all();
+    if (profiler.flushThread.joinable()) profiler.flushThread.join();
+
+    Flush();
+
+    std::lock_guard<std::mutex> lock(profiler.flushMutex);
+    profiler.file << "\n]\n";
+    profiler.file.close();
+
+}
+
+void Profiler::Flush()
+{
+
+    ProfilerState& profiler = state();
+    std::lock_guard<std::mutex> lock(profiler.flushMutex);
+    if (!profiler.file.is_open()) return;
+
+    std::vector<ThreadBuffer*> buffers;
+    {
+        std::lock_guard<std::mutex> buffersLock(profiler.buffersMutex);
+        for (auto& buffer : profiler.buffers) buffers.push_back(buffer.get());
+    }
+
+    for (ThreadBuffer* buffer : buffers)
+    {
+
+        if (!buffer->nameWritten)
+        {
+            writeSeparator(profiler);
+            profiler.file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId << ",\"args\":{\"name\":\"";
+            writeEscaped(profiler.file, buffer->threadName.c_str());
+            profiler.file << "\"}}";
+            buffer->nameWritten = true;
+        }
+
+        uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+
+        for (; tail != head; tail++)
+        {
+            ProfileEvent const& event = buffer->events[tail % ThreadBuffer::CAPACITY];
+
+            // Complete events, timestamps in microseconds
+            writeSeparator(profiler);
+            profiler.file << "{\"name\":\"";
+            writeEscaped(profiler.file, event.name);
+            profiler.file << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+                << ",\"ts\":" << event.start / 1000 << '.' << event.start % 1000 / 100
+                << ",\"dur\":" << (event.end - event.start) / 1000 << '.' << (event.end - event.start) % 1000 / 100
+                << "}";
+        }
+
+        buffer->tail.store(tail, std::memory_order_release);
+
+        uint64_t dropped = buffer->dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0)
+        {
+            std::cout << "[PROFILER] " << buffer->threadName << " dropped " << dropped << " events, flush more often" << std::endl;
+        }
+
+    }
+
+    profiler.file.flush();
+
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+    ThreadBuffer& buffer = threadBuffer();
+
+    std::lock_guard<std::mutex> lock(state().flushMutex);
+    buffer.threadName = name;
+    buffer.nameWritten = false;
+}
+
+uint64_t Profiler::Now()
+{
+    // Never 0 so a scope opened before the capture can be told apart
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - state().epoch).count()) + 1;
+}
+
+void Profiler::Record(const char* name, uint64_t start, uint64_t end)
+{
+
+    ThreadBuffer& buffer = threadBuffer();
+
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    if (head - buffer.tail.load(std::memory_order_acquire) >= ThreadBuffer::CAPACITY)
+    {
+        // Never block the recording thread, the flush reports what was lost
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    buffer.events[head % ThreadBuffer::CAPACITY] = { name, start, end };
+    buffer.head.store(head + 1, std::memory_order_release);
+
 }
@@ -1,20 +1,79 @@
 ﻿#pragma once
+
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <string>
 
+// Profiling stays compiled in release builds, scopes cost a relaxed atomic load
+// while no capture is running. Define PROFILER_ENABLE=0 to strip them completely.
+#ifndef PROFILER_ENABLE
+#define PROFILER_ENABLE 1
+#endif
 
-struct Task
+// Times the enclosing block, the name must outlive the capture (string literal)
+class ProfileScope
 {
-    std::string name;
-    std::chrono::high_resolution_clock::time_point mStart;
+public:
+    ProfileScope(const char* name);
+    ~ProfileScope();
+
+    ProfileScope(ProfileScope const&) = delete;
+    ProfileScope& operator=(ProfileScope const&) = delete;
+
+private:
+    const char* m_name;
+    uint64_t m_start;
 };
 
+// Scopes are pushed into a lock-free ring owned by the recording thread and a
+// background thread drains every ring into a Chrome/Perfetto JSON trace.
+// Nested scopes become nested slices since they are complete events on the same thread.
 class Profiler
 {
 public:
-    ~Profiler();
-    static void NewTask(std::string name);
-    static void EndTask();
+    // Start a capture, the trace file is flushed every flushIntervalMs
+    static void Start(std::string const& tracePath, uint32_t flushIntervalMs = 1000);
+    // Write the remaining events and close the trace
+    static void Stop();
+    static void Flush();
+
+    static bool IsCapturing();
+    static void SetThreadName(const char* name);
+
+    // Nanoseconds since the profiler started, used as event timestamps
+    static uint64_t Now();
+    static void Record(const char* name, uint64_t start, uint64_t end);
+
 private:
-    static inline Task* mTask = new Task();
-};   
+    static inline std::atomic<bool> sCapturing = false;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if PROFILER_ENABLE
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#endif
+
+inline bool Profiler::IsCapturing()
+{
+    return sCapturing.load(std::memory_order_relaxed);
+}
+
+inline ProfileScope::ProfileScope(const char* name)
+    : m_name(name), m_start(Profiler::IsCapturing() ? Profiler::Now() : 0)
+{
+}
+
+inline ProfileScope::~ProfileScope()
+{
+    if (m_start != 0 && Profiler::IsCapturing())
+    {
+        Profiler::Record(m_name, m_start, Profiler::Now());
+    }
+}
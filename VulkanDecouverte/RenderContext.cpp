@@ -0,0 +1,1034 @@
+#include "RenderContext.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "GpuProfiler.h"
+#include "GpuScene.h"
+#include "JobSystem.h"
+#include "LayoutCache.h"
+#include "Mesh.h"
+#include "Profiler.h"
+#include "RenderObject.h"
+#include "RenderPipeline.h"
+#include "Sampler.h"
+#include "Shader.h"
+#include "Texture.h"
+#include "UploadManager.h"
+
+// Objects culled per job, a multiple of the 8 spheres of a SIMD step
+static constexpr uint32_t CULL_GRAIN_SIZE = 2048;
+
+// Bounding sphere of a mesh moved by the object transform, the radius grows with the largest scale
+static vec4 transformSphere(mat4 const& transform, vec4 const& sphere)
+{
+
+    vec3 center = vec3(transform * vec4(vec3(sphere), 1.0f));
+    float scale = std::max({ length(vec3(transform[0])), length(vec3(transform[1])), length(vec3(transform[2])) });
+
+    return vec4(center, sphere.w * scale);
+
+}
+
+RenderContext::RenderContext()
+    : m_device(&Application::getInstance()->getDevice())
+{
+
+    ubo.proj = mat4(1.0f);
+    ubo.view = mat4(1.0f);
+
+}
+
+RenderContext::~RenderContext()
+{
+
+    delete m_meshCache;
+    delete m_pipelineRegistry;
+    delete m_renderTarget;
+
+    delete m_defaultSampler;
+    delete m_defaultTexture;
+
+    vkDestroyRenderPass(*m_device, m_renderPass, nullptr);
+
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        vkDestroyFence(*m_device, m_inFlightFences[i], nullptr);
+
+        // Buffers
+        Application::getInstance()->destroyBuffer(m_uniformBuffers[i], m_uniformBuffersMemory[i]);
+
+        // The descriptor sets go away with the pool
+        for (ObjectPage& page : m_objectPages[i]) {
+            Application::getInstance()->destroyBuffer(page.buffer, page.memory);
+        }
+    }
+
+    delete m_gpuProfiler;
+
+    vkDestroyDescriptorPool(*m_device, m_descriptorPool, nullptr);
+
+    vkDestroyCommandPool(*m_device, m_commandPool, nullptr);
+
+    for (std::vector<RecordingPool>& pools : m_recordingPools) {
+        for (RecordingPool& pool : pools) {
+            vkDestroyCommandPool(*m_device, pool.pool, nullptr);
+        }
+    }
+
+}
+
+void RenderContext::Initialize()
+{
+
+    createTargetImages();
+
+    createRenderPass();
+
+    createDescriptorSetLayout();
+
+    m_renderTarget = new RenderTarget(this);
+    m_pipelineRegistry = new PipelineRegistry();
+    m_meshCache = new MeshCache(*this);
+
+    createFramebuffers();
+
+    createCommandPool();
+
+    m_gpuProfiler = new GpuProfiler(MAX_FRAMES_IN_FLIGHT);
+
+    createDepthResources();
+
+    createUniformBuffers();
+
+    createDescriptorPool();
+
+    m_defaultTexture = new Texture(*this, "sunflower.jpg");
+    m_defaultSampler = new Sampler();
+
+    createDescriptorSets();
+
+    createCommandBuffer();
+
+    createSyncObjects();
+
+}
+
+void RenderContext::createRenderPass()
+{
+
+    VkAttachmentDescription colorAttachment{};
+    colorAttachment.format = m_colorFormat;
+    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    colorAttachment.finalLayout = getFinalLayout();
+
+    VkAttachmentReference colorAttachmentRef{};
+    colorAttachmentRef.attachment = 0;
+    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorAttachmentRef;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &colorAttachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+
+    if (vkCreateRenderPass(*m_device, &renderPassInfo, nullptr, &m_renderPass) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create render pass!");
+    }
+}
+
+void RenderContext::createDescriptorSetLayout()
+{
+
+    // The sets of the context are the ones the default shaders declare: the camera,
+    // the object matrices and the texture
+    Shader sVertex(DEFAULT_VERTEX_SHADER, Shader::VERTEX);
+    Shader sFragment(DEFAULT_FRAGMENT_SHADER, Shader::FRAGMENT);
+
+    ShaderReflection reflection = sVertex.getReflection();
+    reflection.merge(sFragment.getReflection());
+
+    m_descriptorSetLayout = Application::getInstance()->getLayoutCache().getDescriptorSetLayout(reflection.getSetBindings(0));
+}
+
+void RenderContext::createCommandPool()
+{
+
+    QueueFamilyIndices queueFamilyIndices = Application::getInstance()->getQueueFamilies();
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+
+    if (vkCreateCommandPool(*m_device, &poolInfo, nullptr, &m_commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create command pool!");
+    }
+
+    // One pool per thread of the job system and per frame slot, reset whole when the slot comes back
+    uint32_t threadCount = Application::getInstance()->getJobSystem().getWorkerCount() + 1;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    m_recordingPools.resize(MAX_FRAMES_IN_FLIGHT);
+    for (std::vector<RecordingPool>& pools : m_recordingPools)
+    {
+        pools.resize(threadCount);
+        for (RecordingPool& pool : pools) {
+            if (vkCreateCommandPool(*m_device, &poolInfo, nullptr, &pool.pool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create command pool!");
+            }
+        }
+    }
+
+}
+
+void RenderContext::createDepthResources()
+{
+
+    VkFormat depthFormat = findDepthFormat();
+
+}
+
+void RenderContext::createUniformBuffers()
+{
+
+    VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+
+    m_uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    m_uniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+    m_uniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        Application::getInstance()->createBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            m_uniformBuffers[i], m_uniformBuffersMemory[i], bufferSize);
+
+        m_uniformBuffersMapped[i] = m_uniformBuffersMemory[i].mapped;
+    }
+
+    // The pages are created with the descriptor sets, they need the default texture
+    m_objectPages.resize(MAX_FRAMES_IN_FLIGHT);
+
+}
+
+void RenderContext::createDescriptorPool()
+{
+
+    // One set per object page, and one per frame slot for the GPU scene
+    uint32_t setCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT) * (MAX_OBJECT_PAGES + 1);
+
+    std::vector<VkDescriptorPoolSize> poolSizes = {
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, setCount },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, setCount },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, setCount },
+    };
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = setCount;
+
+    if (vkCreateDescriptorPool(*m_device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor pool!");
+    }
+}
+
+void RenderContext::createDescriptorSets()
+{
+
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        addObjectPage(i);
+    }
+
+}
+
+RenderContext::ObjectPage& RenderContext::addObjectPage(uint32_t frame)
+{
+
+    std::vector<ObjectPage>& pages = m_objectPages[frame];
+    if (pages.size() == MAX_OBJECT_PAGES) {
+        throw std::runtime_error("too many objects drawn in a single frame!");
+    }
+
+    // A page is bound whole, it never goes past the storage buffer range
+    uint64_t capacity = static_cast<uint64_t>(OBJECT_PAGE_CAPACITY) << pages.size();
+    uint32_t maxRange = Application::getInstance()->GetPhysicalDeviceProperties().limits.maxStorageBufferRange;
+    capacity = std::min<uint64_t>(capacity, maxRange / sizeof(mat4));
+
+    ObjectPage page{};
+    page.capacity = static_cast<uint32_t>(capacity);
+
+    // Coherent, the block is shared with other resources so no flush per frame
+    Application::getInstance()->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        page.buffer, page.memory, page.capacity * sizeof(mat4));
+
+    page.descriptorSet = createObjectDescriptorSet(frame, page.buffer);
+
+    pages.push_back(page);
+    return pages.back();
+
+}
+
+VkDescriptorSet RenderContext::createObjectDescriptorSet(uint32_t frame, VkBuffer objectBuffer)
+{
+
+    VkDescriptorSet descriptorSet;
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.pSetLayouts = &m_descriptorSetLayout;
+    allocInfo.descriptorSetCount = 1;
+
+    if (vkAllocateDescriptorSets(*m_device, &allocInfo, &descriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate descriptor sets!");
+    }
+
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = m_uniformBuffers[frame];
+    bufferInfo.offset = 0;
+    bufferInfo.range = sizeof(UniformBufferObject);
+
+    VkDescriptorBufferInfo objectBufferInfo{};
+    objectBufferInfo.buffer = objectBuffer;
+    objectBufferInfo.offset = 0;
+    objectBufferInfo.range = VK_WHOLE_SIZE;
+
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.imageView = m_defaultTexture->getImageView();
+    imageInfo.sampler = m_defaultSampler->getSampler();
+
+    VkWriteDescriptorSet writeDescriptorSet {};
+    writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writeDescriptorSet.dstSet = descriptorSet;
+    writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    writeDescriptorSet.dstBinding = 0;
+    writeDescriptorSet.pBufferInfo = &bufferInfo;
+    writeDescriptorSet.descriptorCount = 1;
+
+    VkWriteDescriptorSet writeObjectDescriptorSet {};
+    writeObjectDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writeObjectDescriptorSet.dstSet = descriptorSet;
+    writeObjectDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writeObjectDescriptorSet.dstBinding = 1;
+    writeObjectDescriptorSet.pBufferInfo = &objectBufferInfo;
+    writeObjectDescriptorSet.descriptorCount = 1;
+
+    VkWriteDescriptorSet writeTextureDescriptorSet {};
+    writeTextureDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writeTextureDescriptorSet.dstSet = descriptorSet;
+    writeTextureDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writeTextureDescriptorSet.dstBinding = 2;
+    writeTextureDescriptorSet.descriptorCount = 1;
+    writeTextureDescriptorSet.pImageInfo = &imageInfo;
+
+    std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+        writeDescriptorSet,
+        writeObjectDescriptorSet,
+        writeTextureDescriptorSet
+    };
+
+    vkUpdateDescriptorSets(*m_device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+
+    return descriptorSet;
+
+}
+
+void RenderContext::createCommandBuffer()
+{
+
+    m_commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = m_commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = (uint32_t) m_commandBuffers.size();
+
+    if (vkAllocateCommandBuffers(*m_device, &allocInfo, m_commandBuffers.data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate command buffers!");
+    }
+
+}
+
+void RenderContext::createSyncObjects()
+{
+
+    m_inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        if (vkCreateFence(*m_device, &fenceInfo, nullptr, &m_inFlightFences[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create synchronization objects for a frame!");
+        }
+    }
+
+}
+
+VkImageView RenderContext::createImageView(VkImage image, VkFormat format)
+{
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    VkImageView imageView;
+    if (vkCreateImageView(Application::getInstance()->getDevice(), &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create texture image view!");
+    }
+
+    return imageView;
+}
+
+const VkExtent2D& RenderContext::getExtent2D()
+{
+    return m_extent;
+}
+
+const VkRenderPass& RenderContext::getRenderPass()
+{
+    return m_renderPass;
+}
+
+VkDescriptorSetLayout& RenderContext::getDescriptorLayout()
+{
+    return m_descriptorSetLayout;
+}
+
+const VkCommandBuffer& RenderContext::getCommandBuffer()
+{
+
+    // The pass only executes secondary buffers, the inline work goes to one opened on demand
+    if (m_passCommands == VK_NULL_HANDLE)
+    {
+        JobSystem& jobs = Application::getInstance()->getJobSystem();
+
+        VkCommandBuffer commandBuffer;
+        if (acquireSecondary(m_recordingPools[currentFrame][jobs.getThreadIndex()], commandBuffer) != VK_SUCCESS
+            || beginSecondary(commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording secondary command buffer!");
+        }
+
+        // Dynamic state is not inherited from the primary buffer
+        setViewport(commandBuffer);
+        m_passCommands = commandBuffer;
+    }
+
+    return m_passCommands;
+
+}
+
+void RenderContext::flushCommands()
+{
+
+    if (m_passCommands == VK_NULL_HANDLE) return;
+
+    if (vkEndCommandBuffer(m_passCommands) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record secondary command buffer!");
+    }
+
+    vkCmdExecuteCommands(m_commandBuffers[currentFrame], 1, &m_passCommands);
+    m_passCommands = VK_NULL_HANDLE;
+
+}
+
+uint32_t RenderContext::beginPassScope(const char* name)
+{
+    return m_gpuProfiler->beginScope(getCommandBuffer(), name);
+}
+
+void RenderContext::endPassScope(uint32_t scope)
+{
+    m_gpuProfiler->endScope(getCommandBuffer(), scope);
+}
+
+GpuProfiler& RenderContext::getGpuProfiler()
+{
+    return *m_gpuProfiler;
+}
+
+VkPipelineLayout& RenderContext::getPipelineLayout()
+{
+    return m_renderTarget->getPipelineLayout();
+}
+
+PipelineDescription RenderContext::getPipelineDescription()
+{
+
+    PipelineDescription description;
+
+    description.vertexBindings = { Vertex::getBindingDescription() };
+    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+    description.vertexAttributes.assign(attributeDescriptions.begin(), attributeDescriptions.end());
+
+    description.shaders = { { DEFAULT_FRAGMENT_SHADER, Shader::FRAGMENT }, { DEFAULT_VERTEX_SHADER, Shader::VERTEX } };
+
+    description.colorFormat = m_colorFormat;
+    description.renderPass = m_renderPass;
+
+    return description;
+
+}
+
+RenderPipeline& RenderContext::getPipeline(PipelineDescription const& description)
+{
+    return m_pipelineRegistry->get(description);
+}
+
+PipelineRegistry& RenderContext::getPipelineRegistry()
+{
+    return *m_pipelineRegistry;
+}
+
+MeshCache& RenderContext::getMeshCache()
+{
+    return *m_meshCache;
+}
+
+void RenderContext::setCamera(vec3 const& position, vec3 const& target)
+{
+    m_cameraPosition = position;
+    m_cameraTarget = target;
+}
+
+Frustum const& RenderContext::getFrustum() const
+{
+    return m_frustum;
+}
+
+void RenderContext::setGpuScene(GpuScene* scene)
+{
+    m_gpuScene = scene;
+}
+
+float RenderContext::getFenceWaitTime() const
+{
+    return m_fenceWaitTime;
+}
+
+float RenderContext::getGpuFrameTime() const
+{
+    return (float)m_gpuProfiler->getGpuFrameTime();
+}
+
+bool RenderContext::hasGpuFrameTime() const
+{
+    return m_gpuFrameTimeValid;
+}
+
+RenderQueue::Stats const& RenderContext::getDrawStats() const
+{
+    return m_lastDrawStats;
+}
+
+void RenderContext::update()
+{
+
+    PROFILE_FUNCTION();
+
+    // Update Uniform Bffer
+    ubo.view = lookAt(m_cameraPosition, m_cameraTarget, vec3(0.0f, 1.0f, 0.0f));
+    ubo.proj = perspective(radians(70.0f), (float)m_extent.width / (float)m_extent.height, 0.1f, FAR_PLANE);
+    ubo.proj[1][1] *= -1.0f;
+
+    m_frustum = Frustum::FromMatrix(ubo.proj * ubo.view);
+
+    memcpy(m_uniformBuffersMapped[currentFrame], &ubo, sizeof(ubo));
+
+}
+
+void RenderContext::clear()
+{
+
+    PROFILE_FUNCTION();
+
+    m_imageIndex = flushCommand();
+    VkCommandBuffer& buffer = m_commandBuffers[currentFrame];
+
+    // The frame slot is free, so are the secondary buffers recorded for it
+    for (RecordingPool& pool : m_recordingPools[currentFrame])
+    {
+        vkResetCommandPool(*m_device, pool.pool, 0);
+        pool.used = 0;
+    }
+
+    // Nothing is recorded yet, the rebuilt pipelines can take over
+    m_pipelineRegistry->swapReloaded(MAX_FRAMES_IN_FLIGHT);
+    // Same for the meshes evicted, and the released ones go if the cache is over budget
+    m_meshCache->collect(MAX_FRAMES_IN_FLIGHT);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = 0; // Optional
+    beginInfo.pInheritanceInfo = nullptr; // Optional
+
+    // Flags can be
+    // VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT: This is a secondary command buffer that will be entirely within a single render pass.
+    // VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT: The command buffer will be rerecorded right after executing it once.
+
+    if (vkBeginCommandBuffer(buffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording command buffer!");
+    }
+
+    m_gpuProfiler->beginFrame(buffer, currentFrame);
+    m_frameScope = m_gpuProfiler->beginScope(buffer, "Frame");
+
+    // Compute work cannot be recorded inside a render pass
+    if (m_gpuScene != nullptr)
+    {
+        uint32_t cullingScope = m_gpuProfiler->beginScope(buffer, "Culling");
+        m_gpuScene->cull(buffer, currentFrame, m_frustum);
+        m_gpuProfiler->endScope(buffer, cullingScope);
+    }
+
+    m_renderPassScope = m_gpuProfiler->beginScope(buffer, "Render pass");
+
+    beginRenderPass();
+    m_passCommands = VK_NULL_HANDLE;
+
+    m_objectPage = 0;
+    m_objectPageUsed = 0;
+    m_drawStats = RenderQueue::Stats();
+}
+
+void RenderContext::beginRenderPass()
+{
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = m_renderPass;
+    renderPassInfo.framebuffer = getFramebuffer(m_imageIndex);
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = m_extent;
+    renderPassInfo.clearValueCount = 1;
+    renderPassInfo.pClearValues = &m_clearColor;
+
+    // A single pass per frame, everything drawn in it is recorded in secondary buffers
+    vkCmdBeginRenderPass(m_commandBuffers[currentFrame], &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+}
+
+VkResult RenderContext::beginSecondary(VkCommandBuffer commandBuffer)
+{
+
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = m_renderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = getFramebuffer(m_imageIndex);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    return vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+}
+
+void RenderContext::setViewport(VkCommandBuffer buffer)
+{
+
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(m_extent.width);
+    viewport.height = static_cast<float>(m_extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(buffer, 0, 1, &viewport);
+
+    VkRect2D scissor{};
+    scissor.offset = {0, 0};
+    scissor.extent = m_extent;
+    vkCmdSetScissor(buffer, 0, 1, &scissor);
+
+}
+
+void RenderContext::drawObject(RenderPipeline& pipeline, RenderObject& object)
+{
+
+    RenderPipeline* resolved = pipeline.resolve();
+    if (resolved == nullptr)
+    {
+        m_drawStats.pipelineNotReady++;
+        return;
+    }
+
+    if (!m_frustum.intersectsSphere(transformSphere(object.getTransform(), object.getMesh()->getBoundingSphere())))
+    {
+        m_drawStats.culled++;
+        return;
+    }
+
+    queueObject(*resolved, object);
+
+}
+
+void RenderContext::queueObject(RenderPipeline& pipeline, RenderObject& object)
+{
+
+    mat4 const& transform = object.getTransform();
+
+    // No depth buffer yet, far objects are recorded first so the near ones cover them
+    float distance = glm::distance(m_cameraPosition, vec3(transform[3]));
+    float depth = 1.0f - distance / FAR_PLANE;
+
+    RenderQueue::Packet packet;
+    packet.key = RenderQueue::MakeKey(0, pipeline.getId(), 0, object.getMesh()->getId(), depth);
+    packet.pipeline = &pipeline;
+    packet.mesh = object.getMesh();
+    packet.transform = &transform;
+    m_renderQueue.push(packet);
+
+}
+
+void RenderContext::drawObjects(RenderPipeline& pipeline, std::vector<RenderObject*> const& objects)
+{
+
+    PROFILE_FUNCTION();
+
+    // Resolved once for the whole list, a compilation ending meanwhile only shows next frame
+    RenderPipeline* resolved = pipeline.resolve();
+    if (resolved == nullptr)
+    {
+        m_drawStats.pipelineNotReady += static_cast<uint32_t>(objects.size());
+        return;
+    }
+
+    m_cullSpheres.resize(objects.size());
+    m_cullVisible.resize(objects.size());
+
+    // Spheres and flags of a range only depend on its objects, the queue is filled afterwards in order
+    Application::getInstance()->getJobSystem().parallelFor(static_cast<uint32_t>(objects.size()), CULL_GRAIN_SIZE,
+        [this, &objects](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+                m_cullSpheres.set(i, transformSphere(objects[i]->getTransform(), objects[i]->getMesh()->getBoundingSphere()));
+            }
+            m_frustum.cullSpheres(m_cullSpheres, begin, end, m_cullVisible.data());
+        });
+
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        if (m_cullVisible[i]) {
+            queueObject(*resolved, *objects[i]);
+        } else {
+            m_drawStats.culled++;
+        }
+    }
+
+}
+
+void RenderContext::flushDraws()
+{
+
+    PROFILE_FUNCTION();
+
+    if (m_renderQueue.empty()) return;
+
+    m_renderQueue.sort();
+
+    m_drawStats.packets += static_cast<uint32_t>(m_renderQueue.size());
+
+    // Page slots are taken in order here, the copies and the recording can then run anywhere
+    m_drawItems.clear();
+
+    size_t first = 0;
+    while (first < m_renderQueue.size())
+    {
+        RenderQueue::Packet const& packet = m_renderQueue[first];
+
+        // Packets sharing pipeline and mesh are next to each other, each run becomes one instanced draw
+        size_t last = first + 1;
+        while (last < m_renderQueue.size()
+            && m_renderQueue[last].pipeline == packet.pipeline
+            && m_renderQueue[last].mesh == packet.mesh) {
+            last++;
+        }
+
+        // A run bigger than what is left in the page continues in the next one
+        while (first < last)
+        {
+            DrawItem item;
+            item.pipeline = packet.pipeline;
+            item.mesh = packet.mesh;
+            item.firstPacket = static_cast<uint32_t>(first);
+            item.slot = reserveObjects(static_cast<uint32_t>(last - first), item.count);
+            item.page = m_objectPage;
+            m_drawItems.push_back(item);
+
+            first += item.count;
+        }
+    }
+
+    JobSystem& jobs = Application::getInstance()->getJobSystem();
+    if (m_drawItems.size() < PARALLEL_RECORD_MIN_DRAWS || jobs.getWorkerCount() == 0) {
+        recordDraws(getCommandBuffer(), 0, static_cast<uint32_t>(m_drawItems.size()), m_drawStats);
+    } else {
+        recordDrawsParallel();
+    }
+
+    m_renderQueue.clear();
+
+}
+
+void RenderContext::recordDraws(VkCommandBuffer commandBuffer, uint32_t firstItem, uint32_t endItem, RenderQueue::Stats& stats)
+{
+
+    // Whatever was recorded before (ImGui...) may have changed the bindings
+    VkPipeline boundPipeline = VK_NULL_HANDLE;
+    VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+    VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
+    VkDescriptorSet boundDescriptorSet = VK_NULL_HANDLE;
+
+    for (uint32_t i = firstItem; i < endItem; i++)
+    {
+        DrawItem const& item = m_drawItems[i];
+        ObjectPage& page = m_objectPages[currentFrame][item.page];
+
+        mat4* models = static_cast<mat4*>(page.memory.mapped) + item.slot;
+        for (uint32_t instance = 0; instance < item.count; instance++) {
+            models[instance] = *m_renderQueue[item.firstPacket + instance].transform;
+        }
+
+        VkPipeline pipeline = item.pipeline->getGraphicsPipeline();
+        if (pipeline != boundPipeline) {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            boundPipeline = pipeline;
+        } else {
+            stats.bindsElided++;
+        }
+
+        if (item.mesh->getVertexBuffer() != boundVertexBuffer) {
+            VkBuffer vertexBuffers[] = {
+                item.mesh->getVertexBuffer()
+            };
+
+            VkDeviceSize offsets[] = {0};
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+            boundVertexBuffer = item.mesh->getVertexBuffer();
+        } else {
+            stats.bindsElided++;
+        }
+
+        if (item.mesh->getIndexBuffer() != boundIndexBuffer) {
+            vkCmdBindIndexBuffer(commandBuffer, item.mesh->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+            boundIndexBuffer = item.mesh->getIndexBuffer();
+        } else {
+            stats.bindsElided++;
+        }
+
+        if (page.descriptorSet != boundDescriptorSet) {
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, item.pipeline->getPipelineLayout(),
+                0, 1, &page.descriptorSet, 0, nullptr);
+            boundDescriptorSet = page.descriptorSet;
+        } else {
+            stats.bindsElided++;
+        }
+
+        // The first instance is the slot of the first matrix in the page
+        vkCmdDrawIndexed(commandBuffer, item.mesh->getIndexCount(), item.count, 0, 0, item.slot);
+        stats.drawCalls++;
+    }
+
+}
+
+void RenderContext::recordDrawsParallel()
+{
+
+    PROFILE_FUNCTION();
+
+    // What was recorded in the pass so far runs before the draws
+    flushCommands();
+
+    uint32_t itemCount = static_cast<uint32_t>(m_drawItems.size());
+    uint32_t chunkCount = (itemCount + RECORD_CHUNK_SIZE - 1) / RECORD_CHUNK_SIZE;
+    m_recordChunks.assign(chunkCount, RecordChunk());
+
+    // An exception cannot leave a job, each chunk keeps its error for the calling thread
+    JobSystem& jobs = Application::getInstance()->getJobSystem();
+    jobs.parallelFor(chunkCount, 1, [this, &jobs, itemCount](uint32_t begin, uint32_t end) {
+        for (uint32_t chunk = begin; chunk < end; chunk++)
+        {
+            RecordChunk& record = m_recordChunks[chunk];
+
+            record.result = acquireSecondary(m_recordingPools[currentFrame][jobs.getThreadIndex()], record.commandBuffer);
+            if (record.result == VK_SUCCESS) {
+                record.result = beginSecondary(record.commandBuffer);
+            }
+            if (record.result != VK_SUCCESS) continue;
+
+            setViewport(record.commandBuffer);
+            recordDraws(record.commandBuffer, chunk * RECORD_CHUNK_SIZE, std::min((chunk + 1) * RECORD_CHUNK_SIZE, itemCount), record.stats);
+
+            record.result = vkEndCommandBuffer(record.commandBuffer);
+        }
+    });
+
+    std::vector<VkCommandBuffer> secondaries;
+    secondaries.reserve(chunkCount);
+    for (RecordChunk const& record : m_recordChunks)
+    {
+        if (record.result != VK_SUCCESS) {
+            throw std::runtime_error("failed to record secondary command buffer!");
+        }
+
+        secondaries.push_back(record.commandBuffer);
+        m_drawStats.drawCalls += record.stats.drawCalls;
+        m_drawStats.bindsElided += record.stats.bindsElided;
+    }
+
+    vkCmdExecuteCommands(m_commandBuffers[currentFrame], chunkCount, secondaries.data());
+
+}
+
+VkResult RenderContext::acquireSecondary(RecordingPool& pool, VkCommandBuffer& commandBuffer)
+{
+
+    if (pool.used == pool.buffers.size())
+    {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = pool.pool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkResult result = vkAllocateCommandBuffers(*m_device, &allocInfo, &commandBuffer);
+        if (result != VK_SUCCESS) return result;
+
+        pool.buffers.push_back(commandBuffer);
+    }
+
+    commandBuffer = pool.buffers[pool.used++];
+    return VK_SUCCESS;
+
+}
+
+void RenderContext::drawScene(RenderPipeline& pipeline)
+{
+
+    if (m_gpuScene == nullptr) return;
+
+    RenderPipeline* resolved = pipeline.resolve();
+    if (resolved == nullptr) return;
+
+    m_drawStats.drawCalls += m_gpuScene->draw(getCommandBuffer(), currentFrame, *resolved);
+
+}
+
+uint32_t RenderContext::reserveObjects(uint32_t count, uint32_t& granted)
+{
+
+    std::vector<ObjectPage>& pages = m_objectPages[currentFrame];
+    if (m_objectPageUsed == pages[m_objectPage].capacity)
+    {
+        m_objectPage++;
+        m_objectPageUsed = 0;
+        if (m_objectPage == pages.size()) addObjectPage(currentFrame);
+    }
+
+    uint32_t slot = m_objectPageUsed;
+    granted = std::min(count, pages[m_objectPage].capacity - slot);
+    m_objectPageUsed += granted;
+
+    return slot;
+
+}
+
+void RenderContext::display()
+{
+
+    PROFILE_FUNCTION();
+
+    flushDraws();
+    flushCommands();
+    m_lastDrawStats = m_drawStats;
+
+    VkCommandBuffer& buffer = m_commandBuffers[currentFrame];
+    vkCmdEndRenderPass(buffer);
+
+    m_gpuProfiler->endScope(buffer, m_renderPassScope);
+    m_gpuProfiler->endScope(buffer, m_frameScope);
+    m_gpuProfiler->endFrame();
+
+    // Uploads recorded during the frame reach the queue before the draws using them
+    Application::getInstance()->getUploadManager().submit();
+
+    if (vkEndCommandBuffer(buffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record command buffer!");
+    }
+
+    submitCommand();
+
+    currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+}
+
+void RenderContext::waitForFrame()
+{
+
+    PROFILE_FUNCTION();
+
+    auto waitStart = std::chrono::high_resolution_clock::now();
+    vkWaitForFences(*m_device, 1, &m_inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    m_fenceWaitTime = (float)(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - waitStart).count());
+
+    // The fence is signaled so the timestamps of this slot are available, no need to wait on them
+    m_gpuFrameTimeValid = m_gpuProfiler->collect(currentFrame);
+
+    Application::getInstance()->getUploadManager().collect();
+
+}
+
+VkFormat RenderContext::findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling,
+    VkFormatFeatureFlags features)
+{
+    for (VkFormat format : candidates) {
+        VkFormatProperties props;
+        vkGetPhysicalDeviceFormatProperties(Application::getInstance()->getPhysicalDevice(), format, &props);
+
+        if (tiling == VK_IMAGE_TILING_LINEAR && (props.linearTilingFeatures & features) == features) {
+            return format;
+        } else if (tiling == VK_IMAGE_TILING_OPTIMAL && (props.optimalTilingFeatures & features) == features) {
+            return format;
+        }
+    }
+
+    throw std::runtime_error("failed to find supported format!");
+
+}
+
+VkFormat RenderContext::findDepthFormat()
+{
+    return findSupportedFormat(
+        {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
+    );
+}
+
+bool RenderContext::hasStencilComponent(VkFormat format)
+{
+    return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
+}
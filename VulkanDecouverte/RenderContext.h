@@ -0,0 +1,256 @@
+#pragma once
+
+#include "framework.h"
+
+#include "Application.h"
+#include "Frustum.h"
+#include "MeshCache.h"
+#include "PipelineRegistry.h"
+#include "RenderQueue.h"
+#include "RenderTarget.h"
+
+class GpuProfiler;
+class GpuScene;
+class Texture;
+class Sampler;
+class RenderPipeline;
+class RenderObject;
+
+// Everything a frame needs that does not depend on where the image ends up.
+// RenderWindow presents through a swapchain, RenderTexture keeps its own images
+// so the whole draw path can run without a display.
+class RenderContext {
+
+	struct UniformBufferObject {
+		mat4 view;
+		mat4 proj;
+	} ubo;
+
+	// Model matrices of one frame slot, the vertex shader reads them at gl_InstanceIndex.
+	// A full page is never reallocated while the frame is recorded, the next one is used instead
+	// and every page is kept for the following frames of the slot.
+	struct ObjectPage {
+		VkBuffer buffer;
+		Allocation memory;
+		VkDescriptorSet descriptorSet;
+		uint32_t capacity;
+	};
+
+	// An instanced draw of the render queue, its matrices go to slot..slot+count of the page
+	struct DrawItem {
+		RenderPipeline* pipeline;
+		Mesh const* mesh;
+		uint32_t firstPacket;
+		uint32_t count;
+		uint32_t page;
+		uint32_t slot;
+	};
+
+	// Secondary buffers of one thread for one frame slot, reused once the slot comes back
+	struct RecordingPool {
+		VkCommandPool pool = VK_NULL_HANDLE;
+		std::vector<VkCommandBuffer> buffers;
+		uint32_t used = 0;
+	};
+
+	struct RecordChunk {
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VkResult result = VK_SUCCESS;
+		RenderQueue::Stats stats;
+	};
+
+public:
+	const int MAX_FRAMES_IN_FLIGHT = 2;
+	// Objects of the first page of a frame slot, each new page doubles it
+	const uint32_t OBJECT_PAGE_CAPACITY = 1024;
+	const uint32_t MAX_OBJECT_PAGES = 16;
+	const float FAR_PLANE = 256.0f;
+	// Below this many draws a flush is recorded in the command buffer of the pass, above it
+	// the draws are split into secondary buffers of RECORD_CHUNK_SIZE draws recorded by the job system
+	const uint32_t PARALLEL_RECORD_MIN_DRAWS = 128;
+	const uint32_t RECORD_CHUNK_SIZE = 32;
+	// Their descriptor set 0 is the one of the context, reflected at creation
+	static constexpr char const* DEFAULT_VERTEX_SHADER = "shader.vert";
+	static constexpr char const* DEFAULT_FRAGMENT_SHADER = "shader.frag";
+
+	RenderContext();
+	virtual ~RenderContext();
+
+	void Initialize();
+
+	void createRenderPass();
+	void createDescriptorSetLayout();
+	void createCommandPool();
+	void createDepthResources();
+	void createUniformBuffers();
+	void createDescriptorPool();
+	void createDescriptorSets();
+	void createCommandBuffer();
+	virtual void createSyncObjects();
+
+	VkImageView createImageView(VkImage image, VkFormat format);
+
+	VkExtent2D const& getExtent2D();
+	VkRenderPass const& getRenderPass();
+	VkDescriptorSetLayout& getDescriptorLayout();
+	// Secondary buffer for what is drawn in the render pass right now, opened on demand
+	VkCommandBuffer const& getCommandBuffer();
+	// Execute what was recorded in getCommandBuffer, the next call opens a new buffer
+	void flushCommands();
+	// GPU scope around what the pass records between the two calls, parallel draws included
+	uint32_t beginPassScope(const char* name);
+	void endPassScope(uint32_t scope);
+
+	VkPipelineLayout& getPipelineLayout();
+	GpuProfiler& getGpuProfiler();
+
+	// Default state for this target: the default shaders, its render pass and format and the
+	// Vertex layout. The pipeline layout is reflected from the shaders, their set 0 has to
+	// match the one of the context for drawObject. Change what differs, then ask getPipeline for it
+	PipelineDescription getPipelineDescription();
+	// Same description, same pipeline. Owned by the context
+	RenderPipeline& getPipeline(PipelineDescription const& description);
+	PipelineRegistry& getPipelineRegistry();
+	// Meshes loaded from files, shared and evicted over its budget. Owned by the context
+	MeshCache& getMeshCache();
+
+	// Set laid out like an object page, binding 1 reading the given matrices
+	VkDescriptorSet createObjectDescriptorSet(uint32_t frame, VkBuffer objectBuffer);
+
+	void setCamera(vec3 const& position, vec3 const& target);
+	Frustum const& getFrustum() const;
+
+	// Culled on the GPU at the start of every frame, before the render pass. Not owned,
+	// the context has descriptor sets for a single scene
+	void setGpuScene(GpuScene* scene);
+
+	// Timings of the last frame slot that came back from the GPU, in milliseconds
+	float getFenceWaitTime() const;
+	float getGpuFrameTime() const;
+	bool hasGpuFrameTime() const;
+	// Render queue counters of the last displayed frame
+	RenderQueue::Stats const& getDrawStats() const;
+
+	virtual void update();
+
+	void clear();
+	// Queue the object when it is in the frustum, the draws are sorted and recorded by flushDraws.
+	// A pipeline still compiling is replaced by its fallback, or the object is skipped
+	void drawObject(RenderPipeline& pipeline, RenderObject& object);
+	// Same, the objects are culled together with SIMD
+	void drawObjects(RenderPipeline& pipeline, std::vector<RenderObject*> const& objects);
+	// Record the queued draws now, display does it for whatever is left.
+	// Objects sharing a pipeline and a mesh become one instanced draw
+	void flushDraws();
+	// Record the indirect draws of the GPU scene
+	void drawScene(RenderPipeline& pipeline);
+	void display();
+
+protected:
+
+	Texture* m_defaultTexture;
+	Sampler* m_defaultSampler;
+
+	VkDevice const* m_device;
+
+	// Images the render pass writes into, filled by the derived target
+	VkFormat m_colorFormat;
+	VkExtent2D m_extent;
+
+	RenderTarget* m_renderTarget;
+	VkRenderPass m_renderPass;
+
+	// Destroyed before the render passes it was built for
+	PipelineRegistry* m_pipelineRegistry;
+	MeshCache* m_meshCache;
+
+	// Reflected from the default shaders, owned by the layout cache
+	VkDescriptorSetLayout m_descriptorSetLayout;
+	VkDescriptorPool m_descriptorPool;
+
+	// Command list
+	VkCommandPool m_commandPool;
+	std::vector<VkCommandBuffer> m_commandBuffers;
+	// Per frame slot, per job system thread. The last one is the main thread's, no other
+	// thread records, see JobSystem::getThreadIndex
+	std::vector<std::vector<RecordingPool>> m_recordingPools;
+	// Open secondary of the pass returned by getCommandBuffer, null once executed
+	VkCommandBuffer m_passCommands = VK_NULL_HANDLE;
+
+	// Synchronization objects
+	uint32_t currentFrame = 0;
+	uint32_t m_imageIndex = 0;
+	std::vector<VkFence> m_inFlightFences;
+
+	// Per pass GPU timings, read back after the frame fence
+	GpuProfiler* m_gpuProfiler;
+	uint32_t m_frameScope = 0;
+	uint32_t m_renderPassScope = 0;
+	float m_fenceWaitTime = 0.0f;
+	bool m_gpuFrameTimeValid = false;
+
+	// Constant buffers
+
+	// Page being filled in the current frame and the slots already written in it
+	uint32_t m_objectPage = 0;
+	uint32_t m_objectPageUsed = 0;
+	RenderQueue m_renderQueue;
+	std::vector<DrawItem> m_drawItems;
+	std::vector<RecordChunk> m_recordChunks;
+	RenderQueue::Stats m_drawStats;
+	RenderQueue::Stats m_lastDrawStats;
+
+	GpuScene* m_gpuScene = nullptr;
+	Frustum m_frustum;
+
+	// World bounding spheres of the objects given to drawObjects and their culling result
+	SphereList m_cullSpheres;
+	std::vector<uint8_t> m_cullVisible;
+
+	std::vector<VkBuffer>		m_uniformBuffers;
+	std::vector<Allocation>		m_uniformBuffersMemory;
+	std::vector<void*>			m_uniformBuffersMapped;
+
+	std::vector<std::vector<ObjectPage>> m_objectPages;
+
+	VkClearValue m_clearColor = { {{0.0f, 0.2f, 0.0f, 1.0f}} };
+
+	vec3 m_cameraPosition = vec3(-5.0f, 3.0f, -5.0f);
+	vec3 m_cameraTarget = vec3(0.0f, 0.0f, 0.0f);
+
+	VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
+	VkFormat findDepthFormat();
+	bool hasStencilComponent(VkFormat format);
+
+	void queueObject(RenderPipeline& pipeline, RenderObject& object);
+
+	void beginRenderPass();
+	// Begin a secondary buffer continuing the render pass of the frame
+	VkResult beginSecondary(VkCommandBuffer commandBuffer);
+	void setViewport(VkCommandBuffer buffer);
+
+	// Copy the matrices and record the draw items of [firstItem, endItem)
+	void recordDraws(VkCommandBuffer commandBuffer, uint32_t firstItem, uint32_t endItem, RenderQueue::Stats& stats);
+	void recordDrawsParallel();
+	VkResult acquireSecondary(RecordingPool& pool, VkCommandBuffer& commandBuffer);
+
+	// Append a page to a frame slot, with its own buffer and descriptor set
+	ObjectPage& addObjectPage(uint32_t frame);
+	// Take up to count consecutive slots of the current page, moving to the next page when it is full
+	uint32_t reserveObjects(uint32_t count, uint32_t& granted);
+
+	// Wait for the GPU to release the current frame slot and collect its timings
+	void waitForFrame();
+
+	// Hooks implemented by the concrete target
+	virtual void createTargetImages() = 0;
+	virtual void createFramebuffers() = 0;
+	virtual VkFramebuffer getFramebuffer(uint32_t imageIndex) = 0;
+	virtual VkImageLayout getFinalLayout() = 0;
+
+	// Wait for the frame slot and return the image to render into
+	virtual uint32_t flushCommand() = 0;
+	// Hand the recorded command buffer of the current frame to the GPU
+	virtual void submitCommand() = 0;
+
+};
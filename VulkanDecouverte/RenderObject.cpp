@@ -1,15 +1,16 @@
 ﻿#include "RenderObject.h"
 
-RenderObject::RenderObject(Mesh* mesh)
-    : m_transform(mat4(1.0f))
-{
-    m_mesh = mesh;
+#include "TransformStore.h"
 
-    reset();
+RenderObject::RenderObject(Mesh* mesh, TransformStore& store)
+    : m_mesh(mesh), m_store(&store)
+{
+    m_transform = m_store->create();
 }
 
 RenderObject::~RenderObject()
 {
+    m_store->release(m_transform);
 }
 
 Mesh const* RenderObject::getMesh()
@@ -19,92 +20,81 @@ Mesh const* RenderObject::getMesh()
 
 mat4 const& RenderObject::getTransform()
 {
-    return m_transform;
+    return m_store->getWorldMatrix(m_transform);
 }
 
-vec3& RenderObject::getPosition()
+vec3 const& RenderObject::getPosition()
 {
-    return m_position;
+    return m_store->getPosition(m_transform);
 }
 
-vec3 const& RenderObject::forward()
+vec3 RenderObject::forward()
 {
-    return m_forward;
+    return m_store->getRotation(m_transform) * vec3(0.0f, 0.0f, 1.0f);
 }
 
 vec3 RenderObject::backward()
 {
-    return m_forward * -1.0f;
+    return forward() * -1.0f;
 }
 
-vec3 const& RenderObject::right()
+vec3 RenderObject::right()
 {
-    return m_right;
+    return m_store->getRotation(m_transform) * vec3(1.0f, 0.0f, 0.0f);
 }
 
 vec3 RenderObject::left()
 {
-    return m_right * -1.0f;
+    return right() * -1.0f;
 }
 
-vec3 const& RenderObject::up()
+vec3 RenderObject::up()
 {
-    return m_up;
+    return m_store->getRotation(m_transform) * vec3(0.0f, 1.0f, 0.0f);
 }
 
 vec3 RenderObject::down()
 {
-    return m_up * -1.0f;
+    return up() * -1.0f;
 }
 
 void RenderObject::setPosition(vec3 const& position)
 {
-    m_position = position;
+    m_store->setPosition(m_transform, position);
 }
 
 void RenderObject::offsetPosition(vec3 const& position)
 {
-    m_position += position;
+    m_store->setPosition(m_transform, m_store->getPosition(m_transform) + position);
 }
 
 void RenderObject::rotateYPR(vec3 const& rotation)
 {
 
-    vec3 RIGHT		= { 1, 0, 0 };
-    vec3 UP			= { 0, 1, 0 };
-    vec3 FORWARD	= { 0, 0, 1 };
+    // Every angle turns around the axes the object had before the call
+    vec3 axisRight = right();
+    vec3 axisForward = forward();
+    vec3 axisUp = up();
 
-    m_rotationMatrix = rotate(m_rotationMatrix, rotation.x, right());
-    m_rotationMatrix = rotate(m_rotationMatrix, rotation.y, forward());
-    m_rotationMatrix = rotate(m_rotationMatrix, rotation.z, up());
+    quat rotated = m_store->getRotation(m_transform);
+    rotated = angleAxis(rotation.x, axisRight) * rotated;
+    rotated = angleAxis(rotation.y, axisForward) * rotated;
+    rotated = angleAxis(rotation.z, axisUp) * rotated;
 
-    m_right     = { m_rotationMatrix[0][0], m_rotationMatrix[0][1], m_rotationMatrix[0][2] };
-    m_up        = { m_rotationMatrix[1][0], m_rotationMatrix[1][1], m_rotationMatrix[1][2] };
-    m_forward   = { m_rotationMatrix[2][0], m_rotationMatrix[2][1], m_rotationMatrix[2][2] };
+    m_store->setRotation(m_transform, normalize(rotated));
     
 }
 
 void RenderObject::update()
 {
-    
-    m_transform = mat4(1.0f);
-    
-    m_transform = scale(m_transform, m_scale);
-    m_transform *= m_rotationMatrix;
-    m_transform = translate(m_transform, m_position);
-    
+    m_store->update(m_transform);
 }
 
 void RenderObject::reset()
 {
     
-    m_position  = vec3(0.0f);
-    m_scale     = vec3(1.0f);
-    
-    m_right     = vec3( 1.0f, 0.0f, 0.0f );
-    m_up        = vec3( 0.0f, 1.0f, 0.0f );
-    m_forward   = vec3( 0.0f, 0.0f, 1.0f );
-
-    m_rotationMatrix = mat4(1.0f);
+    m_store->setPosition(m_transform, vec3(0.0f));
+    m_store->setRotation(m_transform, quat(1.0f, 0.0f, 0.0f, 0.0f));
+    m_store->setScale(m_transform, vec3(1.0f));
 
 }
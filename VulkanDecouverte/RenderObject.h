@@ -3,35 +3,32 @@
 #include "framework.h"
 
 class Mesh;
+class TransformStore;
 
+// Handle to a transform of a TransformStore and the mesh drawn with it
 class RenderObject
 {
     Mesh* m_mesh;
-    mat4 m_transform;
-
-    vec3 m_forward;
-    vec3 m_right;
-    vec3 m_up;
-
-    vec3 m_scale;
-    vec3 m_position;
-
-    mat4 m_rotationMatrix;
+    TransformStore* m_store;
+    uint32_t m_transform;
 
 public:
 
-    RenderObject(Mesh* mesh);
+    RenderObject(Mesh* mesh, TransformStore& store);
     ~RenderObject();
+
+    RenderObject(RenderObject const&) = delete;
+    RenderObject& operator=(RenderObject const&) = delete;
     
     Mesh const* getMesh();
     mat4 const& getTransform();
 
-    vec3& getPosition();
-    vec3 const& forward();
+    vec3 const& getPosition();
+    vec3 forward();
     vec3 backward();
-    vec3 const& right();
+    vec3 right();
     vec3 left();
-    vec3 const& up();
+    vec3 up();
     vec3 down();
 
     void setPosition(vec3 const& position);
@@ -1,35 +1,100 @@
 ﻿#include "RenderPipeline.h"
 
+#include <algorithm>
+#include <filesystem>
+#include <string>
 #include <vector>
 
 #include "Application.h"
-#include "Mesh.h"
-#include "RenderWindow.h"
+#include "LayoutCache.h"
+#include "Profiler.h"
 #include "Shader.h"
 
-RenderPipeline::RenderPipeline(std::vector<Shader*> shaders, RenderWindow& window)
+RenderPipeline::RenderPipeline(PipelineDescription const& description)
+    : m_description(description)
+{
+    compile();
+}
+
+RenderPipeline::RenderPipeline(PipelineDescription const& description, RenderPipeline* fallback)
+    : m_description(description), m_fallback(fallback)
+{
+}
+
+void RenderPipeline::compile()
+{
+
+    std::lock_guard<std::mutex> compileLock(m_compileMutex);
+    if (isReady()) return;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+
+    try {
+        build(pipeline, layout);
+    } catch (...) {
+        m_state.store(State::FAILED, std::memory_order_release);
+        throw;
+    }
+
+    std::lock_guard<std::mutex> lock(m_rebuildMutex);
+
+    // A rebuild of a failed pipeline was swapped in meanwhile, it is already drawn with
+    if (isReady())
+    {
+        vkDestroyPipeline(Application::getInstance()->getDevice(), pipeline, nullptr);
+        return;
+    }
+
+    m_graphicsPipeline = pipeline;
+    m_pipelineLayout = layout;
+    m_state.store(State::READY, std::memory_order_release);
+
+}
+
+void RenderPipeline::build(VkPipeline& pipeline, VkPipelineLayout& layout) const
 {
 
+    PROFILE_FUNCTION();
+
+    PipelineDescription const& description = m_description;
+
+    // The modules are only needed while the pipeline is created
+    std::vector<std::unique_ptr<Shader>> shaders;
     std::vector<VkPipelineShaderStageCreateInfo> infos;
 
-    for (auto& shader : shaders)
+    ShaderReflection reflection;
+
+    for (ShaderStage const& stage : description.shaders)
     {
-        infos.push_back(shader->getShaderInformation());
+        shaders.push_back(std::make_unique<Shader>(stage.path, stage.type, stage.defines));
+        infos.push_back(shaders.back()->getShaderInformation());
+        reflection.merge(shaders.back()->getReflection());
     }
 
-    auto bindingDescription = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+    // Every input of the vertex shader has to be fed by an attribute
+    for (ShaderReflection::VertexInput const& input : reflection.getVertexInputs())
+    {
+        bool fed = std::any_of(description.vertexAttributes.begin(), description.vertexAttributes.end(),
+            [&input](VkVertexInputAttributeDescription const& attribute) { return attribute.location == input.location; });
+        if (!fed) {
+            throw std::runtime_error("failed to create graphics pipeline, vertex input " + std::to_string(input.location) + " has no attribute!");
+        }
+    }
+
+    layout = description.layout != VK_NULL_HANDLE ? description.layout
+        : Application::getInstance()->getLayoutCache().getPipelineLayout(reflection);
 
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(description.vertexBindings.size());
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(description.vertexAttributes.size());
+    vertexInputInfo.pVertexBindingDescriptions = description.vertexBindings.data();
+    vertexInputInfo.pVertexAttributeDescriptions = description.vertexAttributes.data();
 
     VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
     inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.topology = description.topology;
     inputAssembly.primitiveRestartEnable = VK_FALSE;
     
     std::vector<VkDynamicState> dynamicStates = {
@@ -63,10 +128,10 @@ RenderPipeline::RenderPipeline(std::vector<Shader*> shaders, RenderWindow& windo
     rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
     rasterizer.depthClampEnable = VK_FALSE;
     rasterizer.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.polygonMode = description.polygonMode;
     rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizer.cullMode = description.cullMode;
+    rasterizer.frontFace = description.frontFace;
     rasterizer.depthBiasEnable = VK_FALSE;
     rasterizer.depthBiasConstantFactor = 0.0f; // Optional
     rasterizer.depthBiasClamp = 0.0f; // Optional
@@ -83,13 +148,13 @@ RenderPipeline::RenderPipeline(std::vector<Shader*> shaders, RenderWindow& windo
 
     VkPipelineColorBlendAttachmentState colorBlendAttachment{};
     colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_TRUE;
-    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.blendEnable = description.blend ? VK_TRUE : VK_FALSE;
+    colorBlendAttachment.srcColorBlendFactor = description.srcColorBlend;
+    colorBlendAttachment.dstColorBlendFactor = description.dstColorBlend;
+    colorBlendAttachment.colorBlendOp = description.colorBlendOp;
+    colorBlendAttachment.srcAlphaBlendFactor = description.srcAlphaBlend;
+    colorBlendAttachment.dstAlphaBlendFactor = description.dstAlphaBlend;
+    colorBlendAttachment.alphaBlendOp = description.alphaBlendOp;
 
     VkPipelineColorBlendStateCreateInfo colorBlending{};
     colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
@@ -104,15 +169,11 @@ RenderPipeline::RenderPipeline(std::vector<Shader*> shaders, RenderWindow& windo
 
     VkPipelineDepthStencilStateCreateInfo pipelineDepthStencilStateCreateInfo {};
     pipelineDepthStencilStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-    pipelineDepthStencilStateCreateInfo.depthTestEnable = VK_TRUE;
-    pipelineDepthStencilStateCreateInfo.depthWriteEnable = VK_TRUE;
-    pipelineDepthStencilStateCreateInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    pipelineDepthStencilStateCreateInfo.depthTestEnable = description.depthTest ? VK_TRUE : VK_FALSE;
+    pipelineDepthStencilStateCreateInfo.depthWriteEnable = description.depthWrite ? VK_TRUE : VK_FALSE;
+    pipelineDepthStencilStateCreateInfo.depthCompareOp = description.depthCompare;
     pipelineDepthStencilStateCreateInfo.back.compareOp = VK_COMPARE_OP_ALWAYS;
 
-    VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {};
-    pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
-    vkCreatePipelineCache(Application::getInstance()->getDevice(), &pipelineCacheCreateInfo, nullptr, &m_pipelineCache);
-    
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
     pipelineInfo.stageCount = static_cast<uint32_t>(infos.size());
@@ -125,27 +186,120 @@ RenderPipeline::RenderPipeline(std::vector<Shader*> shaders, RenderWindow& windo
     pipelineInfo.pDepthStencilState = &pipelineDepthStencilStateCreateInfo;
     pipelineInfo.pColorBlendState = &colorBlending;
     pipelineInfo.pDynamicState = &dynamicState;
-    pipelineInfo.layout = window.getPipelineLayout();
-    pipelineInfo.renderPass = window.getRenderPass();
+    pipelineInfo.layout = layout;
+    pipelineInfo.renderPass = description.renderPass;
     pipelineInfo.flags = 0;
-    pipelineInfo.subpass = 0;
+    pipelineInfo.subpass = description.subpass;
     pipelineInfo.basePipelineIndex = -1;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-    if (vkCreateGraphicsPipelines(Application::getInstance()->getDevice(), m_pipelineCache, 1,
-                                  &pipelineInfo, nullptr, &m_graphicsPipeline) != VK_SUCCESS) {
+    if (vkCreateGraphicsPipelines(Application::getInstance()->getDevice(), Application::getInstance()->getPipelineCache(), 1,
+                                  &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
         throw std::runtime_error("failed to create graphics pipeline!");
     }
-    
+
+}
+
+void RenderPipeline::compileNoThrow()
+{
+
+    try {
+        compile();
+    } catch (std::exception const& exception) {
+        m_state.store(State::FAILED, std::memory_order_release);
+        std::cout << "Pipeline compilation failed: " << exception.what() << std::endl;
+    }
+
+}
+
+void RenderPipeline::rebuild()
+{
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+
+    try {
+        build(pipeline, layout);
+    } catch (std::exception const& exception) {
+        // The current pipeline keeps drawing, the next save of the shader tries again
+        std::cout << "Pipeline rebuild failed: " << exception.what() << std::endl;
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_rebuildMutex);
+
+    // Two saves in a row, the older result was never used
+    if (m_rebuiltPipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(Application::getInstance()->getDevice(), m_rebuiltPipeline, nullptr);
+    }
+
+    m_rebuiltPipeline = pipeline;
+    m_rebuiltLayout = layout;
+
+}
+
+bool RenderPipeline::swapRebuilt(VkPipeline& retired)
+{
+
+    std::lock_guard<std::mutex> lock(m_rebuildMutex);
+    if (m_rebuiltPipeline == VK_NULL_HANDLE) return false;
+
+    // Still pending, the first compilation would overwrite the rebuilt pipeline
+    if (m_state.load(std::memory_order_acquire) == State::PENDING) return false;
+
+    retired = m_graphicsPipeline;
+    m_graphicsPipeline = m_rebuiltPipeline;
+    m_pipelineLayout = m_rebuiltLayout;
+    m_rebuiltPipeline = VK_NULL_HANDLE;
+
+    // A pipeline whose first compilation failed works from now on
+    m_state.store(State::READY, std::memory_order_release);
+
+    return true;
+
+}
+
+bool RenderPipeline::usesShader(std::string const& path) const
+{
+
+    // Only the sources name a stage, the shader cache skips those the include did not change
+    bool include = std::filesystem::path(path).extension() == ".glsl";
+
+    return std::any_of(m_description.shaders.begin(), m_description.shaders.end(),
+        [&path, include](ShaderStage const& stage) { return stage.path == path || (include && ShaderCompiler::IsGlsl(stage.path)); });
+
+}
+
+bool RenderPipeline::isReady() const
+{
+    return m_state.load(std::memory_order_acquire) == State::READY;
+}
+
+RenderPipeline* RenderPipeline::resolve()
+{
+
+    if (isReady()) return this;
+    return m_fallback != nullptr ? m_fallback->resolve() : nullptr;
+
 }
 
 RenderPipeline::~RenderPipeline()
 {
-    vkDestroyPipelineCache(Application::getInstance()->getDevice(), m_pipelineCache, nullptr);
     vkDestroyPipeline(Application::getInstance()->getDevice(), m_graphicsPipeline, nullptr);
+    vkDestroyPipeline(Application::getInstance()->getDevice(), m_rebuiltPipeline, nullptr);
 }
 
 VkPipeline& RenderPipeline::getGraphicsPipeline()
 {
     return m_graphicsPipeline;
 }
+
+VkPipelineLayout RenderPipeline::getPipelineLayout() const
+{
+    return m_pipelineLayout;
+}
+
+uint32_t RenderPipeline::getId() const
+{
+    return m_id;
+}
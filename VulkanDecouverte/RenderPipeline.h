@@ -1,20 +1,68 @@
 ﻿#pragma once
 
+#include <atomic>
+#include <mutex>
+#include <string>
+
 #include "framework.h"
 
-class Shader;
-class RenderTarget;
-class RenderWindow;
+#include "PipelineRegistry.h"
 
 class RenderPipeline
 {
 public:
-    RenderPipeline(std::vector<Shader*> shaders, RenderWindow& window);
+    // Compiles right away, go through the PipelineRegistry of the context to share pipelines
+    RenderPipeline(PipelineDescription const& description);
+    // Left to compile() for a worker, the draws use the fallback until it is done
+    RenderPipeline(PipelineDescription const& description, RenderPipeline* fallback);
     ~RenderPipeline();
 
+    // Throws when the driver refuses the pipeline. Does nothing once ready, concurrent
+    // calls compile once and the others wait for it
+    void compile();
+    // Same, a failure is only logged and the fallback is kept for good
+    void compileNoThrow();
+
+    // Compile again from the shader files, for a worker. The result waits for swapRebuilt,
+    // the current pipeline keeps drawing meanwhile and a failure leaves it in place
+    void rebuild();
+    // At a frame boundary, when no recording is running. True when a rebuilt pipeline
+    // took over, retired is then the previous one for the caller to destroy once the GPU is done
+    bool swapRebuilt(VkPipeline& retired);
+    // Path relative to the shader folder. An included GLSL file may be read by any
+    // GLSL stage, those pipelines all count as users
+    bool usesShader(std::string const& path) const;
+
+    bool isReady() const;
+    // Pipeline the draws of this frame go through: this one once compiled, else the
+    // fallback when it is ready itself, else none and the draws are skipped
+    RenderPipeline* resolve();
+
     VkPipeline& getGraphicsPipeline();
+    // From the description, or reflected from the shaders and shared through the layout cache
+    VkPipelineLayout getPipelineLayout() const;
+    uint32_t getId() const;
 
 private:
-    VkPipelineCache m_pipelineCache{ VK_NULL_HANDLE };
+    enum class State { PENDING, READY, FAILED };
+
+    PipelineDescription m_description;
+    RenderPipeline* m_fallback = nullptr;
+    std::atomic<State> m_state{ State::PENDING };
+
     VkPipeline m_graphicsPipeline{ VK_NULL_HANDLE };
+    VkPipelineLayout m_pipelineLayout{ VK_NULL_HANDLE };
+
+    // Held for the whole first compilation or a retry of a failed one
+    std::mutex m_compileMutex;
+    // Guards the swap of the drawn pipeline, and the rebuilt one waiting for it
+    std::mutex m_rebuildMutex;
+    VkPipeline m_rebuiltPipeline{ VK_NULL_HANDLE };
+    VkPipelineLayout m_rebuiltLayout{ VK_NULL_HANDLE };
+
+    void build(VkPipeline& pipeline, VkPipelineLayout& layout) const;
+
+    // Small and stable, used in the render queue sort keys
+    uint32_t m_id = sNextId.fetch_add(1, std::memory_order_relaxed);
+    static inline std::atomic<uint32_t> sNextId = 0;
 };
@@ -0,0 +1,86 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+
+#include "Profiler.h"
+
+uint64_t RenderQueue::MakeKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth)
+{
+
+    uint64_t quantizedDepth = (uint64_t)(std::clamp(depth, 0.0f, 1.0f) * (float)0xFFFFF);
+
+    return ((uint64_t)(pass & 0xF) << 60)
+        | ((uint64_t)(pipeline & 0xFFF) << 48)
+        | ((uint64_t)(material & 0xFFF) << 36)
+        | ((uint64_t)(mesh & 0xFFFF) << 20)
+        | quantizedDepth;
+
+}
+
+void RenderQueue::push(Packet const& packet)
+{
+    m_entries.push_back({ packet.key, static_cast<uint32_t>(m_packets.size()) });
+    m_packets.push_back(packet);
+}
+
+void RenderQueue::sort()
+{
+
+    PROFILE_FUNCTION();
+
+    if (m_entries.size() < 2) return;
+
+    // A byte every key shares does not change the order, most frames only differ on a few
+    uint64_t differingBits = 0;
+    for (SortEntry const& entry : m_entries) {
+        differingBits |= entry.key ^ m_entries[0].key;
+    }
+
+    m_sortScratch.resize(m_entries.size());
+
+    // Least significant byte first, each pass is a stable counting sort
+    for (uint32_t shift = 0; shift < 64; shift += 8)
+    {
+        if (((differingBits >> shift) & 0xFF) == 0) continue;
+
+        uint32_t offsets[256] = {};
+        for (SortEntry const& entry : m_entries) {
+            offsets[(entry.key >> shift) & 0xFF]++;
+        }
+
+        uint32_t total = 0;
+        for (uint32_t& offset : offsets) {
+            uint32_t count = offset;
+            offset = total;
+            total += count;
+        }
+
+        for (SortEntry const& entry : m_entries) {
+            m_sortScratch[offsets[(entry.key >> shift) & 0xFF]++] = entry;
+        }
+
+        m_entries.swap(m_sortScratch);
+    }
+
+}
+
+void RenderQueue::clear()
+{
+    m_packets.clear();
+    m_entries.clear();
+}
+
+size_t RenderQueue::size() const
+{
+    return m_entries.size();
+}
+
+bool RenderQueue::empty() const
+{
+    return m_entries.empty();
+}
+
+RenderQueue::Packet const& RenderQueue::operator[](size_t index) const
+{
+    return m_packets[m_entries[index].packet];
+}
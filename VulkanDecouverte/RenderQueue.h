@@ -0,0 +1,59 @@
+#pragma once
+
+#include "framework.h"
+
+class Mesh;
+class RenderPipeline;
+
+// Draws collected during a frame and recorded in key order, so the draws sharing
+// a pipeline and a mesh end up next to each other.
+// Key from the high bits to the low ones: pass (4) | pipeline (12) | material (12) | mesh (16) | depth (20)
+class RenderQueue
+{
+public:
+    struct Packet
+    {
+        uint64_t key;
+        RenderPipeline* pipeline;
+        Mesh const* mesh;
+        mat4 const* transform;
+    };
+
+    // What the recording of the queue cost, for one frame
+    struct Stats
+    {
+        uint32_t packets = 0;
+        // Objects left out by frustum culling, the packets are the visible ones
+        uint32_t culled = 0;
+        // Objects skipped because their pipeline was still compiling and had no ready fallback
+        uint32_t pipelineNotReady = 0;
+        uint32_t drawCalls = 0;
+        // Pipeline, vertex, index and descriptor set binds skipped because the state was already bound
+        uint32_t bindsElided = 0;
+    };
+
+    // Depth goes from 0 to 1, lower depths are recorded first
+    static uint64_t MakeKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth);
+
+    void push(Packet const& packet);
+    // Stable, packets with the same key keep the order they were pushed in
+    void sort();
+    void clear();
+
+    size_t size() const;
+    bool empty() const;
+    // Packets in sorted order once sort was called
+    Packet const& operator[](size_t index) const;
+
+private:
+    struct SortEntry
+    {
+        uint64_t key;
+        uint32_t packet;
+    };
+
+    std::vector<Packet> m_packets;
+    std::vector<SortEntry> m_entries;
+    std::vector<SortEntry> m_sortScratch;
+
+};
@@ -2,7 +2,7 @@
 
 #include "framework.h"
 
-class RenderWindow;
+class RenderContext;
 
 class RenderTarget
 {
@@ -10,7 +10,7 @@ public:
 
     RenderTarget();
     RenderTarget(int width, int height);
-    RenderTarget(RenderWindow* window);
+    RenderTarget(RenderContext* context);
     ~RenderTarget();
 
     VkPipelineLayout& getPipelineLayout();
@@ -0,0 +1,127 @@
+#include "RenderTexture.h"
+
+RenderTexture::RenderTexture(int width, int height, VkFormat format)
+{
+
+    m_colorFormat = format;
+    m_extent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+
+    // No surface to present to, the device only needs a graphics queue
+    VkSurfaceKHR noSurface = VK_NULL_HANDLE;
+    Application::getInstance()->setupPhysicalDevice(noSurface);
+    Application::getInstance()->setupLogicalDevice(noSurface);
+
+    Initialize();
+
+}
+
+RenderTexture::~RenderTexture()
+{
+
+    waitIdle();
+
+    for (size_t i = 0; i < m_images.size(); i++) {
+        vkDestroyFramebuffer(*m_device, m_framebuffers[i], nullptr);
+        vkDestroyImageView(*m_device, m_imageViews[i], nullptr);
+        Application::getInstance()->destroyImage(m_images[i], m_imagesMemory[i]);
+    }
+
+}
+
+void RenderTexture::createTargetImages()
+{
+
+    m_images.resize(MAX_FRAMES_IN_FLIGHT);
+    m_imagesMemory.resize(MAX_FRAMES_IN_FLIGHT);
+    m_imageViews.resize(MAX_FRAMES_IN_FLIGHT);
+
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        Application::getInstance()->createImage(m_extent.width, m_extent.height, m_colorFormat,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            m_images[i], m_imagesMemory[i]);
+
+        m_imageViews[i] = createImageView(m_images[i], m_colorFormat);
+    }
+
+}
+
+void RenderTexture::createFramebuffers()
+{
+
+    m_framebuffers.resize(m_imageViews.size());
+
+    for (size_t i = 0; i < m_imageViews.size(); i++) {
+        VkImageView attachments[] = {
+            m_imageViews[i]
+        };
+
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = m_renderPass;
+        framebufferInfo.attachmentCount = 1;
+        framebufferInfo.pAttachments = attachments;
+        framebufferInfo.width = m_extent.width;
+        framebufferInfo.height = m_extent.height;
+        framebufferInfo.layers = 1;
+
+        if (vkCreateFramebuffer(*m_device, &framebufferInfo, nullptr, &m_framebuffers[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create framebuffer!");
+        }
+    }
+
+}
+
+VkFramebuffer RenderTexture::getFramebuffer(uint32_t imageIndex)
+{
+    return m_framebuffers[imageIndex];
+}
+
+VkImageLayout RenderTexture::getFinalLayout()
+{
+    // Leave the image ready to be copied out of
+    return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+}
+
+uint32_t RenderTexture::flushCommand()
+{
+
+    // Same frames in flight pacing as the window, minus the swapchain acquire:
+    // the frame slot owns its image so the image index is the frame index
+    waitForFrame();
+    vkResetFences(*m_device, 1, &m_inFlightFences[currentFrame]);
+
+    vkResetCommandBuffer(m_commandBuffers[currentFrame], 0);
+    return currentFrame;
+
+}
+
+void RenderTexture::submitCommand()
+{
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &m_commandBuffers[currentFrame];
+
+    if (vkQueueSubmit(Application::getInstance()->getGraphicQueue(), 1, &submitInfo, m_inFlightFences[currentFrame]) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit draw command buffer!");
+    }
+
+}
+
+VkImage const& RenderTexture::getImage(uint32_t frame)
+{
+    return m_images[frame];
+}
+
+VkImageView const& RenderTexture::getImageView(uint32_t frame)
+{
+    return m_imageViews[frame];
+}
+
+void RenderTexture::waitIdle()
+{
+    vkWaitForFences(*m_device, static_cast<uint32_t>(m_inFlightFences.size()), m_inFlightFences.data(), VK_TRUE, UINT64_MAX);
+}
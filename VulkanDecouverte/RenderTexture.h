@@ -0,0 +1,35 @@
+#pragma once
+
+#include "framework.h"
+
+#include "RenderContext.h"
+
+// Offscreen render target, used to drive the renderer without any window or surface.
+// Every frame in flight owns a device local color image that stays readable after the pass.
+class RenderTexture : public RenderContext {
+
+public:
+	RenderTexture(int width, int height, VkFormat format = VK_FORMAT_R8G8B8A8_UNORM);
+	~RenderTexture() override;
+
+	VkImage const& getImage(uint32_t frame);
+	VkImageView const& getImageView(uint32_t frame);
+
+	// Block until every submitted frame is done, used before reading results back
+	void waitIdle();
+
+protected:
+	std::vector<VkImage> m_images;
+	std::vector<Allocation> m_imagesMemory;
+	std::vector<VkImageView> m_imageViews;
+	std::vector<VkFramebuffer> m_framebuffers;
+
+	void createTargetImages() override;
+	void createFramebuffers() override;
+	VkFramebuffer getFramebuffer(uint32_t imageIndex) override;
+	VkImageLayout getFinalLayout() override;
+
+	uint32_t flushCommand() override;
+	void submitCommand() override;
+
+};
@@ -1,19 +1,27 @@
 ﻿#include "Shader.h"
 
+#include <cstring>
 #include <fstream>
 
+#include "Application.h"
 #include "Mesh.h"
-#include "RenderWindow.h"
 
-Shader::Shader(std::string shaderPath, Type shaderType)
+Shader::Shader(std::string shaderPath, Type shaderType, ShaderDefines const& defines)
 {
     
-    std::vector<char> shaderCode = readFile(SHADER_FOLDER + shaderPath);
+    std::vector<uint32_t> shaderCode;
+    if (ShaderCompiler::IsGlsl(shaderPath)) {
+        shaderCode = ShaderCompiler::Compile(shaderPath, shaderType, defines);
+    } else {
+        std::vector<char> file = readFile(SHADER_FOLDER + shaderPath);
+        shaderCode.resize(file.size() / sizeof(uint32_t));
+        std::memcpy(shaderCode.data(), file.data(), shaderCode.size() * sizeof(uint32_t));
+    }
 
     VkShaderModuleCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = shaderCode.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
+    createInfo.codeSize = shaderCode.size() * sizeof(uint32_t);
+    createInfo.pCode = shaderCode.data();
     
     if (vkCreateShaderModule(Application::getInstance()->getDevice(), &createInfo, nullptr, &mShaderModule) != VK_SUCCESS) {
         throw std::runtime_error("failed to create shader module!");
@@ -23,6 +31,8 @@ Shader::Shader(std::string shaderPath, Type shaderType)
     mPipelineShaderStageInfo.stage = static_cast<VkShaderStageFlagBits>(shaderType);
     mPipelineShaderStageInfo.module = mShaderModule;
     mPipelineShaderStageInfo.pName = "main";
+
+    mReflection = ShaderReflection(shaderCode.data(), shaderCode.size());
     
     
 }
@@ -57,3 +67,8 @@ VkPipelineShaderStageCreateInfo const& Shader::getShaderInformation()
 {
     return mPipelineShaderStageInfo;
 }
+
+ShaderReflection const& Shader::getReflection() const
+{
+    return mReflection;
+}
@@ -2,6 +2,9 @@
 
 #include "framework.h"
 
+#include "ShaderCompiler.h"
+#include "ShaderReflection.h"
+
 class RenderWindow;
 
 class Shader
@@ -19,17 +22,21 @@ public:
         COMPUTE = 0x00000020,
     } Type;
     
-    Shader(std::string shaderPath, Type shaderType);
+    // A .spv path is loaded as is, a GLSL source is compiled with the defines through the ShaderCompiler
+    Shader(std::string shaderPath, Type shaderType, ShaderDefines const& defines = {});
     ~Shader();
     
     std::vector<char> readFile(const std::string& filename);
     VkPipelineShaderStageCreateInfo const& getShaderInformation();
+    // Descriptors, push constants and vertex inputs the code declares
+    ShaderReflection const& getReflection() const;
 
-    static const inline char* SHADER_FOLDER = "res\\shaders\\";
+    static const inline char* SHADER_FOLDER = "res/shaders/";
 
 private:
     
     VkShaderModule mShaderModule;
     VkPipelineShaderStageCreateInfo mPipelineShaderStageInfo;
+    ShaderReflection mReflection;
     
 };
@@ -0,0 +1,178 @@
+#include "ShaderCompiler.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#include <shaderc/shaderc.hpp>
+
+#include "Profiler.h"
+#include "Shader.h"
+
+namespace
+{
+    std::string readText(std::filesystem::path const& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) return {};
+
+        std::stringstream content;
+        content << file.rdbuf();
+        return content.str();
+    }
+
+    // Resolves #include "file" next to the including file first, then in the shader folder
+    class Includer : public shaderc::CompileOptions::IncluderInterface
+    {
+    public:
+        struct Include
+        {
+            std::string name;
+            std::string content;
+            shaderc_include_result result;
+        };
+
+        shaderc_include_result* GetInclude(char const* requestedSource, shaderc_include_type type,
+            char const* requestingSource, size_t includeDepth) override
+        {
+            Include* include = new Include();
+
+            std::filesystem::path candidates[] = {
+                std::filesystem::path(requestingSource).parent_path() / requestedSource,
+                std::filesystem::path(Shader::SHADER_FOLDER) / requestedSource,
+            };
+
+            // #include <file> only looks in the shader folder
+            for (size_t i = type == shaderc_include_type_standard ? 1 : 0; i < std::size(candidates); i++)
+            {
+                if (!std::filesystem::is_regular_file(candidates[i])) continue;
+
+                include->name = candidates[i].generic_string();
+                include->content = readText(candidates[i]);
+                break;
+            }
+
+            // An empty name tells shaderc the include failed, the content is the error then
+            if (include->name.empty()) include->content = std::string("cannot find ") + requestedSource;
+
+            include->result.source_name = include->name.c_str();
+            include->result.source_name_length = include->name.size();
+            include->result.content = include->content.c_str();
+            include->result.content_length = include->content.size();
+            include->result.user_data = include;
+            return &include->result;
+        }
+
+        void ReleaseInclude(shaderc_include_result* data) override
+        {
+            delete static_cast<Include*>(data->user_data);
+        }
+    };
+
+    shaderc_shader_kind shaderKind(uint32_t stage)
+    {
+        switch (stage)
+        {
+            case Shader::VERTEX: return shaderc_vertex_shader;
+            case Shader::TESSELLATION_CONTROL: return shaderc_tess_control_shader;
+            case Shader::TESSELLATION_EVALUATION: return shaderc_tess_evaluation_shader;
+            case Shader::GEOMETRY: return shaderc_geometry_shader;
+            case Shader::FRAGMENT: return shaderc_fragment_shader;
+            case Shader::COMPUTE: return shaderc_compute_shader;
+            default: throw std::runtime_error("failed to compile shader, unknown stage!");
+        }
+    }
+
+    // FNV-1a, 64 bits are plenty for a few hundred permutations
+    uint64_t hashText(uint64_t hash, std::string const& text)
+    {
+        for (unsigned char c : text)
+        {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+}
+
+std::vector<uint32_t> ShaderCompiler::Compile(std::string const& path, uint32_t stage, ShaderDefines const& defines)
+{
+
+    PROFILE_FUNCTION();
+
+    std::string sourcePath = Shader::SHADER_FOLDER + path;
+    std::string source = readText(sourcePath);
+    if (source.empty()) {
+        throw std::runtime_error("failed to read shader " + sourcePath + "!");
+    }
+
+    shaderc::CompileOptions options;
+    options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_0);
+    options.SetOptimizationLevel(shaderc_optimization_level_performance);
+    options.SetIncluder(std::make_unique<Includer>());
+    for (auto const& [name, value] : defines) {
+        options.AddMacroDefinition(name, value);
+    }
+
+    shaderc::Compiler compiler;
+    shaderc_shader_kind kind = shaderKind(stage);
+
+    // The preprocessed text holds the includes and the defines, it is all the key needs
+    shaderc::PreprocessedSourceCompilationResult preprocessed = compiler.PreprocessGlsl(source, kind, sourcePath.c_str(), options);
+    if (preprocessed.GetCompilationStatus() != shaderc_compilation_status_success) {
+        throw std::runtime_error("failed to preprocess " + path + ":\n" + preprocessed.GetErrorMessage());
+    }
+    std::string preprocessedSource(preprocessed.cbegin(), preprocessed.cend());
+
+    uint64_t hash = hashText(14695981039346656037ull, std::to_string(CACHE_VERSION) + ":" + std::to_string(stage) + ":");
+    hash = hashText(hash, preprocessedSource);
+
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+    std::filesystem::path cachePath = std::filesystem::path(CACHE_FOLDER) / (std::string(name) + ".spv");
+
+    std::string cached = readText(cachePath);
+    if (!cached.empty() && cached.size() % sizeof(uint32_t) == 0)
+    {
+        std::vector<uint32_t> code(cached.size() / sizeof(uint32_t));
+        std::memcpy(code.data(), cached.data(), cached.size());
+        return code;
+    }
+
+    shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(preprocessedSource, kind, sourcePath.c_str(), options);
+    if (result.GetCompilationStatus() != shaderc_compilation_status_success) {
+        throw std::runtime_error("failed to compile " + path + ":\n" + result.GetErrorMessage());
+    }
+
+    std::vector<uint32_t> code(result.cbegin(), result.cend());
+
+    // Written aside and renamed, two threads compiling the same permutation write the same bytes
+    std::error_code error;
+    std::filesystem::create_directories(CACHE_FOLDER, error);
+
+    std::filesystem::path temporaryPath = cachePath;
+    temporaryPath += "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<char const*>(code.data()), static_cast<std::streamsize>(code.size() * sizeof(uint32_t)));
+    }
+    std::filesystem::rename(temporaryPath, cachePath, error);
+    if (error) std::filesystem::remove(temporaryPath, error);
+
+    return code;
+
+}
+
+bool ShaderCompiler::IsGlsl(std::string const& path)
+{
+
+    std::string extension = std::filesystem::path(path).extension().string();
+    return extension == ".vert" || extension == ".frag" || extension == ".comp" || extension == ".geom"
+        || extension == ".tesc" || extension == ".tese" || extension == ".glsl";
+
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <utility>
+
+#include "framework.h"
+
+// Name and value of the macros a GLSL source is compiled with, one set per permutation
+using ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+
+// GLSL to SPIR-V in the process, through shaderc. Sources are read from the shader
+// folder and can #include "file" relative to themselves or to the folder.
+// Every result is kept on disk under the hash of the preprocessed source and the
+// options, an unchanged shader is then only preprocessed, never compiled again.
+class ShaderCompiler
+{
+public:
+    // Stage flag as in Shader::Type. Throws with the compiler messages on errors
+    static std::vector<uint32_t> Compile(std::string const& path, uint32_t stage, ShaderDefines const& defines = {});
+
+    // Sources and headers the compiler reads, by extension
+    static bool IsGlsl(std::string const& path);
+
+    static const inline char* CACHE_FOLDER = "shader_cache/";
+
+private:
+    // Bump when the compile options change, the previous results then miss
+    static constexpr uint32_t CACHE_VERSION = 1;
+};
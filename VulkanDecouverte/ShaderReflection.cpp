@@ -0,0 +1,415 @@
+#include "ShaderReflection.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+// From the SPIR-V specification, only the opcodes and enumerants read here
+namespace spv
+{
+    constexpr uint32_t MAGIC = 0x07230203;
+
+    enum Op : uint32_t
+    {
+        OpEntryPoint = 15,
+        OpTypeInt = 21,
+        OpTypeFloat = 22,
+        OpTypeVector = 23,
+        OpTypeMatrix = 24,
+        OpTypeImage = 25,
+        OpTypeSampler = 26,
+        OpTypeSampledImage = 27,
+        OpTypeArray = 28,
+        OpTypeRuntimeArray = 29,
+        OpTypeStruct = 30,
+        OpTypePointer = 32,
+        OpConstant = 43,
+        OpVariable = 59,
+        OpDecorate = 71,
+        OpMemberDecorate = 72,
+    };
+
+    enum Decoration : uint32_t
+    {
+        Block = 2,
+        BufferBlock = 3,
+        ArrayStride = 6,
+        MatrixStride = 7,
+        BuiltIn = 11,
+        Location = 30,
+        Binding = 33,
+        DescriptorSet = 34,
+        Offset = 35,
+    };
+
+    enum StorageClass : uint32_t
+    {
+        UniformConstant = 0,
+        Input = 1,
+        Uniform = 2,
+        PushConstant = 9,
+        StorageBuffer = 12,
+    };
+
+    enum Dim : uint32_t
+    {
+        DimBuffer = 5,
+        DimSubpassData = 6,
+    };
+}
+
+namespace
+{
+    // Result id of a type or a variable with what was said about it
+    struct Id
+    {
+        uint32_t opcode = 0;
+        // Operands after the result id
+        std::vector<uint32_t> operands;
+
+        bool hasBinding = false;
+        bool hasSet = false;
+        bool hasLocation = false;
+        bool builtIn = false;
+        bool block = false;
+        bool bufferBlock = false;
+        uint32_t binding = 0;
+        uint32_t set = 0;
+        uint32_t location = 0;
+        uint32_t arrayStride = 0;
+
+        // Struct members
+        std::vector<uint32_t> memberOffsets;
+        std::vector<uint32_t> memberMatrixStrides;
+    };
+
+    VkShaderStageFlags stageFromExecutionModel(uint32_t model)
+    {
+        switch (model)
+        {
+            case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+            case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+            case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+            case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+            case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+            case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+            default: return 0;
+        }
+    }
+
+    class Parser
+    {
+    public:
+        std::unordered_map<uint32_t, Id> ids;
+
+        Id& at(uint32_t id) { return ids[id]; }
+
+        // Byte size of a type laid out in a block, the strides come from the decorations
+        uint32_t sizeOf(uint32_t typeId, uint32_t matrixStride = 0)
+        {
+            Id& type = at(typeId);
+            switch (type.opcode)
+            {
+                case spv::OpTypeInt:
+                case spv::OpTypeFloat:
+                    return type.operands[0] / 8;
+                case spv::OpTypeVector:
+                    return type.operands[1] * sizeOf(type.operands[0]);
+                case spv::OpTypeMatrix:
+                    return type.operands[1] * (matrixStride != 0 ? matrixStride : sizeOf(type.operands[0]));
+                case spv::OpTypeArray:
+                {
+                    uint32_t length = constantValue(type.operands[1]);
+                    uint32_t stride = type.arrayStride != 0 ? type.arrayStride : sizeOf(type.operands[0], matrixStride);
+                    return length * stride;
+                }
+                case spv::OpTypeStruct:
+                {
+                    uint32_t size = 0;
+                    for (size_t member = 0; member < type.operands.size(); member++)
+                    {
+                        uint32_t offset = member < type.memberOffsets.size() ? type.memberOffsets[member] : 0;
+                        uint32_t stride = member < type.memberMatrixStrides.size() ? type.memberMatrixStrides[member] : 0;
+                        size = std::max(size, offset + sizeOf(type.operands[member], stride));
+                    }
+                    return size;
+                }
+                default:
+                    // Runtime arrays have no size of their own
+                    return 0;
+            }
+        }
+
+        uint32_t constantValue(uint32_t id)
+        {
+            Id& constant = at(id);
+            return constant.opcode == spv::OpConstant ? constant.operands[1] : 1;
+        }
+
+        VkFormat vertexFormat(uint32_t typeId)
+        {
+            Id& type = at(typeId);
+
+            uint32_t components = 1;
+            Id* scalar = &type;
+            if (type.opcode == spv::OpTypeVector)
+            {
+                components = type.operands[1];
+                scalar = &at(type.operands[0]);
+            }
+
+            static const VkFormat floats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+            static const VkFormat ints[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+            static const VkFormat uints[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+            if (components < 1 || components > 4 || scalar->operands.empty() || scalar->operands[0] != 32) return VK_FORMAT_UNDEFINED;
+            if (scalar->opcode == spv::OpTypeFloat) return floats[components - 1];
+            if (scalar->opcode == spv::OpTypeInt) return scalar->operands[1] ? ints[components - 1] : uints[components - 1];
+            return VK_FORMAT_UNDEFINED;
+        }
+    };
+}
+
+ShaderReflection::ShaderReflection(uint32_t const* code, size_t wordCount)
+{
+
+    if (wordCount < 5 || code[0] != spv::MAGIC) {
+        throw std::runtime_error("failed to reflect shader, not a SPIR-V module!");
+    }
+
+    Parser parser;
+    std::vector<uint32_t> variables;
+
+    for (size_t word = 5; word < wordCount;)
+    {
+        uint32_t opcode = code[word] & 0xFFFF;
+        uint32_t count = code[word] >> 16;
+        if (count == 0 || word + count > wordCount) {
+            throw std::runtime_error("failed to reflect shader, truncated instruction!");
+        }
+
+        uint32_t const* operands = code + word + 1;
+        uint32_t operandCount = count - 1;
+
+        switch (opcode)
+        {
+            case spv::OpEntryPoint:
+                m_stages |= stageFromExecutionModel(operands[0]);
+                break;
+
+            case spv::OpTypeInt:
+            case spv::OpTypeFloat:
+            case spv::OpTypeVector:
+            case spv::OpTypeMatrix:
+            case spv::OpTypeImage:
+            case spv::OpTypeSampler:
+            case spv::OpTypeSampledImage:
+            case spv::OpTypeArray:
+            case spv::OpTypeRuntimeArray:
+            case spv::OpTypeStruct:
+            case spv::OpTypePointer:
+            {
+                Id& id = parser.at(operands[0]);
+                id.opcode = opcode;
+                id.operands.assign(operands + 1, operands + operandCount);
+                break;
+            }
+
+            // Result type first, then the result id
+            case spv::OpConstant:
+            case spv::OpVariable:
+            {
+                Id& id = parser.at(operands[1]);
+                id.opcode = opcode;
+                id.operands.assign(operands, operands + operandCount);
+                id.operands.erase(id.operands.begin() + 1);
+                if (opcode == spv::OpVariable) variables.push_back(operands[1]);
+                break;
+            }
+
+            case spv::OpDecorate:
+            {
+                Id& id = parser.at(operands[0]);
+                uint32_t value = operandCount > 2 ? operands[2] : 0;
+                switch (operands[1])
+                {
+                    case spv::Block: id.block = true; break;
+                    case spv::BufferBlock: id.bufferBlock = true; break;
+                    case spv::ArrayStride: id.arrayStride = value; break;
+                    case spv::BuiltIn: id.builtIn = true; break;
+                    case spv::Location: id.hasLocation = true; id.location = value; break;
+                    case spv::Binding: id.hasBinding = true; id.binding = value; break;
+                    case spv::DescriptorSet: id.hasSet = true; id.set = value; break;
+                }
+                break;
+            }
+
+            case spv::OpMemberDecorate:
+            {
+                Id& id = parser.at(operands[0]);
+                uint32_t member = operands[1];
+                uint32_t value = operandCount > 3 ? operands[3] : 0;
+                if (operands[2] == spv::Offset)
+                {
+                    if (id.memberOffsets.size() <= member) id.memberOffsets.resize(member + 1, 0);
+                    id.memberOffsets[member] = value;
+                }
+                else if (operands[2] == spv::MatrixStride)
+                {
+                    if (id.memberMatrixStrides.size() <= member) id.memberMatrixStrides.resize(member + 1, 0);
+                    id.memberMatrixStrides[member] = value;
+                }
+                break;
+            }
+        }
+
+        word += count;
+    }
+
+    for (uint32_t variableId : variables)
+    {
+        Id& variable = parser.at(variableId);
+        uint32_t storageClass = variable.operands[1];
+
+        // Variables are always pointers, what they point to decides the descriptor type
+        Id& pointer = parser.at(variable.operands[0]);
+        uint32_t typeId = pointer.operands[1];
+
+        if (storageClass == spv::PushConstant)
+        {
+            m_pushConstants.stageFlags = m_stages;
+            m_pushConstants.size = std::max(m_pushConstants.size, parser.sizeOf(typeId));
+            continue;
+        }
+
+        if (storageClass == spv::Input)
+        {
+            if ((m_stages & VK_SHADER_STAGE_VERTEX_BIT) && variable.hasLocation && !variable.builtIn) {
+                m_vertexInputs.push_back({ variable.location, parser.vertexFormat(typeId) });
+            }
+            continue;
+        }
+
+        if (storageClass != spv::UniformConstant && storageClass != spv::Uniform && storageClass != spv::StorageBuffer) continue;
+        if (!variable.hasBinding) continue;
+
+        // Arrays of descriptors, a runtime array counts as one
+        uint32_t descriptorCount = 1;
+        while (parser.at(typeId).opcode == spv::OpTypeArray || parser.at(typeId).opcode == spv::OpTypeRuntimeArray)
+        {
+            Id& array = parser.at(typeId);
+            if (array.opcode == spv::OpTypeArray) descriptorCount *= parser.constantValue(array.operands[1]);
+            typeId = array.operands[0];
+        }
+
+        Id& type = parser.at(typeId);
+        VkDescriptorType descriptorType;
+
+        if (storageClass == spv::StorageBuffer || type.bufferBlock) {
+            descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        } else if (storageClass == spv::Uniform) {
+            descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        } else if (type.opcode == spv::OpTypeSampledImage) {
+            descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        } else if (type.opcode == spv::OpTypeSampler) {
+            descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+        } else if (type.opcode == spv::OpTypeImage) {
+            // Operands: sampled type, dim, depth, arrayed, multisampled, sampled (2 for storage)
+            bool storage = type.operands[5] == 2;
+            if (type.operands[1] == spv::DimBuffer) {
+                descriptorType = storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+            } else if (type.operands[1] == spv::DimSubpassData) {
+                descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+            } else {
+                descriptorType = storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            }
+        } else {
+            continue;
+        }
+
+        m_bindings.push_back({ variable.set, variable.binding, descriptorType, descriptorCount, m_stages });
+    }
+
+    std::sort(m_bindings.begin(), m_bindings.end(), [](Binding const& a, Binding const& b) {
+        return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+    });
+
+    std::sort(m_vertexInputs.begin(), m_vertexInputs.end(), [](VertexInput const& a, VertexInput const& b) {
+        return a.location < b.location;
+    });
+
+}
+
+void ShaderReflection::merge(ShaderReflection const& other)
+{
+
+    m_stages |= other.m_stages;
+
+    for (Binding const& binding : other.m_bindings)
+    {
+        auto found = std::find_if(m_bindings.begin(), m_bindings.end(), [&binding](Binding const& existing) {
+            return existing.set == binding.set && existing.binding == binding.binding;
+        });
+
+        if (found == m_bindings.end()) {
+            m_bindings.push_back(binding);
+        } else if (found->type != binding.type) {
+            throw std::runtime_error("failed to merge shader stages, a binding has two descriptor types!");
+        } else {
+            found->stages |= binding.stages;
+            found->count = std::max(found->count, binding.count);
+        }
+    }
+
+    std::sort(m_bindings.begin(), m_bindings.end(), [](Binding const& a, Binding const& b) {
+        return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+    });
+
+    if (other.m_pushConstants.size > 0)
+    {
+        m_pushConstants.stageFlags |= other.m_pushConstants.stageFlags;
+        m_pushConstants.size = std::max(m_pushConstants.size, other.m_pushConstants.size);
+    }
+
+    if (m_vertexInputs.empty()) m_vertexInputs = other.m_vertexInputs;
+
+}
+
+VkShaderStageFlags ShaderReflection::getStages() const
+{
+    return m_stages;
+}
+
+std::vector<ShaderReflection::Binding> const& ShaderReflection::getBindings() const
+{
+    return m_bindings;
+}
+
+uint32_t ShaderReflection::getSetCount() const
+{
+    return m_bindings.empty() ? 0 : m_bindings.back().set + 1;
+}
+
+std::vector<VkDescriptorSetLayoutBinding> ShaderReflection::getSetBindings(uint32_t set) const
+{
+
+    std::vector<VkDescriptorSetLayoutBinding> bindings;
+    for (Binding const& binding : m_bindings)
+    {
+        if (binding.set == set) {
+            bindings.push_back({ binding.binding, binding.type, binding.count, binding.stages, nullptr });
+        }
+    }
+
+    return bindings;
+
+}
+
+VkPushConstantRange const& ShaderReflection::getPushConstants() const
+{
+    return m_pushConstants;
+}
+
+std::vector<ShaderReflection::VertexInput> const& ShaderReflection::getVertexInputs() const
+{
+    return m_vertexInputs;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "framework.h"
+
+// What a SPIR-V module declares through its interface: descriptors, push constants
+// and vertex inputs. Read straight from the words, only what the layouts need.
+// Reflections of several stages merge into the one of a pipeline.
+class ShaderReflection
+{
+public:
+    struct Binding
+    {
+        uint32_t set;
+        uint32_t binding;
+        VkDescriptorType type;
+        uint32_t count;
+        VkShaderStageFlags stages;
+    };
+
+    struct VertexInput
+    {
+        uint32_t location;
+        VkFormat format;
+    };
+
+    ShaderReflection() = default;
+    // Throws when the code is not a SPIR-V module
+    ShaderReflection(uint32_t const* code, size_t wordCount);
+
+    // A binding used by both gets the stages of both, the push constant range covers both
+    void merge(ShaderReflection const& other);
+
+    VkShaderStageFlags getStages() const;
+    // Sorted by set then binding
+    std::vector<Binding> const& getBindings() const;
+    // Highest set used plus one
+    uint32_t getSetCount() const;
+    // Ready for a VkDescriptorSetLayoutCreateInfo, empty for a set nothing uses
+    std::vector<VkDescriptorSetLayoutBinding> getSetBindings(uint32_t set) const;
+    // Zero size without push constants
+    VkPushConstantRange const& getPushConstants() const;
+    // Only filled for a vertex stage, built-ins left out
+    std::vector<VertexInput> const& getVertexInputs() const;
+
+private:
+    VkShaderStageFlags m_stages = 0;
+    std::vector<Binding> m_bindings;
+    VkPushConstantRange m_pushConstants{ 0, 0, 0 };
+    std::vector<VertexInput> m_vertexInputs;
+};
@@ -0,0 +1,105 @@
+#include "ShaderWatcher.h"
+
+#include <set>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "Profiler.h"
+#include "ShaderCompiler.h"
+
+ShaderWatcher::ShaderWatcher(std::string folder)
+    : m_folder(std::move(folder))
+{
+
+#ifdef __linux__
+    m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotify < 0 || inotify_add_watch(m_inotify, m_folder.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        std::cout << "Shader hot reload disabled, cannot watch " << m_folder << std::endl;
+    }
+#else
+    // The files already there are the reference, only later writes count
+    changedFiles();
+#endif
+
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+
+#ifdef __linux__
+    if (m_inotify >= 0) close(m_inotify);
+#endif
+
+}
+
+std::vector<std::string> ShaderWatcher::poll()
+{
+
+    PROFILE_FUNCTION();
+
+    std::vector<std::string> shaderFiles;
+
+    for (std::string const& file : changedFiles())
+    {
+        if (ShaderCompiler::IsGlsl(file)) {
+            shaderFiles.push_back(file);
+        }
+    }
+
+    return shaderFiles;
+
+}
+
+std::vector<std::string> ShaderWatcher::changedFiles()
+{
+
+    std::set<std::string> changed;
+
+#ifdef __linux__
+    if (m_inotify < 0) return {};
+
+    alignas(inotify_event) char buffer[4096];
+    while (true)
+    {
+        ssize_t length = read(m_inotify, buffer, sizeof(buffer));
+        if (length <= 0) break;
+
+        for (ssize_t offset = 0; offset < length;)
+        {
+            inotify_event const* event = reinterpret_cast<inotify_event const*>(buffer + offset);
+            if (event->len > 0) changed.insert(event->name);
+            offset += sizeof(inotify_event) + event->len;
+        }
+    }
+#else
+    auto now = std::chrono::steady_clock::now();
+    if (now - m_lastScan < SCAN_INTERVAL) return {};
+    m_lastScan = now;
+
+    std::error_code error;
+    for (std::filesystem::directory_entry const& entry : std::filesystem::directory_iterator(m_folder, error))
+    {
+        if (!entry.is_regular_file(error)) continue;
+
+        std::string name = entry.path().filename().string();
+        std::filesystem::file_time_type writeTime = entry.last_write_time(error);
+        if (error) continue;
+
+        auto found = m_writeTimes.find(name);
+        if (found == m_writeTimes.end()) {
+            m_writeTimes.emplace(name, writeTime);
+            if (!m_firstScan) changed.insert(name);
+        } else if (found->second != writeTime) {
+            found->second = writeTime;
+            changed.insert(name);
+        }
+    }
+    m_firstScan = false;
+#endif
+
+    return std::vector<std::string>(changed.begin(), changed.end());
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <string>
+
+#include "framework.h"
+
+#include "Shader.h"
+
+// Watches the shader folder while the application runs. The GLSL sources saved there
+// are reported by poll so their pipelines can be rebuilt, the sources are compiled
+// again by the ShaderCompiler when the pipelines are.
+// inotify on Linux, the modification times are scanned twice a second elsewhere.
+class ShaderWatcher
+{
+public:
+    ShaderWatcher(std::string folder = Shader::SHADER_FOLDER);
+    ~ShaderWatcher();
+
+    ShaderWatcher(ShaderWatcher const&) = delete;
+    ShaderWatcher& operator=(ShaderWatcher const&) = delete;
+
+    // Never blocks, call it once per frame. Shader files changed since the last call,
+    // relative to the folder
+    std::vector<std::string> poll();
+
+private:
+    std::string m_folder;
+
+#ifdef __linux__
+    int m_inotify = -1;
+#else
+    static constexpr std::chrono::milliseconds SCAN_INTERVAL{ 500 };
+    std::map<std::string, std::filesystem::file_time_type> m_writeTimes;
+    std::chrono::steady_clock::time_point m_lastScan;
+    // The files found by the first scan are not changes
+    bool m_firstScan = true;
+#endif
+
+    // File names changed since the last call, without duplicates
+    std::vector<std::string> changedFiles();
+};
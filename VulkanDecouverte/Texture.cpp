@@ -3,11 +3,18 @@
 #include <stdexcept>
 
 #include "Application.h"
-#include "RenderWindow.h"
+#include "Profiler.h"
+#include "RenderContext.h"
+#include "UploadManager.h"
+
+// The only user of stb_image, it is compiled here so every executable linking the engine has it
+#define STB_IMAGE_IMPLEMENTATION
 #include "libs/stb_image.h"
 
-Texture::Texture(RenderWindow& renderWindow, std::string const& textureFile)
+Texture::Texture(RenderContext& renderContext, std::string const& textureFile)
 {
+    PROFILE_SCOPE("Texture upload");
+
     int texWidth, texHeight, texChannels;
     stbi_uc* pixels = stbi_load((TEXTURE_FOLDER + textureFile).c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
     VkDeviceSize imageSize = texWidth * texHeight * 4;
@@ -16,21 +23,7 @@ Texture::Texture(RenderWindow& renderWindow, std::string const& textureFile)
         throw std::runtime_error("failed to load texture image!");
     }
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-
-    Application::getInstance()->createBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory, imageSize);
-
-    
-    void* data;
-    vkMapMemory(Application::getInstance()->getDevice(), stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixels, imageSize);
-    vkUnmapMemory(Application::getInstance()->getDevice(), stagingBufferMemory);
-
-    stbi_image_free(pixels);
-
-    createImage(texWidth, texHeight,
+    Application::getInstance()->createImage(texWidth, texHeight,
         VK_FORMAT_R8G8B8A8_SRGB,
         VK_IMAGE_TILING_OPTIMAL,
         VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
@@ -39,24 +32,23 @@ Texture::Texture(RenderWindow& renderWindow, std::string const& textureFile)
         m_textureImageMemory
         );
 
+    // The pixels are copied into the staging ring right away, the layout transitions are recorded with the copy
+    m_uploadTicket = Application::getInstance()->getUploadManager().uploadImage(m_textureImage,
+        static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), pixels, imageSize);
 
-    transitionImageLayout(renderWindow, m_textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    copyBufferToImage(renderWindow, stagingBuffer, m_textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-    transitionImageLayout(renderWindow, m_textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-    vkDestroyBuffer(Application::getInstance()->getDevice(), stagingBuffer, nullptr);
-    vkFreeMemory(Application::getInstance()->getDevice(), stagingBufferMemory, nullptr);
+    stbi_image_free(pixels);
 
-    createTextureImageView(renderWindow);
+    createTextureImageView(renderContext);
     
 }
 
 Texture::~Texture()
 {
+    Application::getInstance()->getUploadManager().wait(m_uploadTicket);
+
     vkDestroyImageView(Application::getInstance()->getDevice(), m_textureImageView, nullptr);
     
-    vkDestroyImage(Application::getInstance()->getDevice(), m_textureImage, nullptr);
-    vkFreeMemory(Application::getInstance()->getDevice(), m_textureImageMemory, nullptr);
+    Application::getInstance()->destroyImage(m_textureImage, m_textureImageMemory);
 }
 
 VkImageView& Texture::getImageView()
@@ -64,115 +56,7 @@ VkImageView& Texture::getImageView()
     return m_textureImageView;
 }
 
-void Texture::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
-                          VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
-    
-    VkImageCreateInfo imageInfo{};
-    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    imageInfo.imageType = VK_IMAGE_TYPE_2D;
-    imageInfo.extent.width = width;
-    imageInfo.extent.height = height;
-    imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
-    imageInfo.arrayLayers = 1;
-    imageInfo.format = format;
-    imageInfo.tiling = tiling;
-    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    imageInfo.usage = usage;
-    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-    if (vkCreateImage(Application::getInstance()->getDevice(), &imageInfo, nullptr, &image) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create image!");
-    }
-
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(Application::getInstance()->getDevice(), image, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = Application::getInstance()->findMemoryType(memRequirements.memoryTypeBits, properties);
-
-    if (vkAllocateMemory(Application::getInstance()->getDevice(), &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate image memory!");
-    }
-
-    vkBindImageMemory(Application::getInstance()->getDevice(), image, imageMemory, 0);
-}
-
-void Texture::createTextureImageView(RenderWindow& renderWindow)
+void Texture::createTextureImageView(RenderContext& renderContext)
 {
-    m_textureImageView = renderWindow.createImageView(m_textureImage, VK_FORMAT_R8G8B8A8_SRGB);
+    m_textureImageView = renderContext.createImageView(m_textureImage, VK_FORMAT_R8G8B8A8_SRGB);
 }
-
-void Texture::transitionImageLayout(RenderWindow& renderWindow, VkImage image, VkFormat format,
-    VkImageLayout oldLayout, VkImageLayout newLayout) {
-    VkCommandBuffer commandBuffer = renderWindow.beginSingleTimeCommands();
-
-    VkImageMemoryBarrier barrier{};
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.oldLayout = oldLayout;
-    barrier.newLayout = newLayout;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.image = image;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
-
-    VkPipelineStageFlags sourceStage;
-    VkPipelineStageFlags destinationStage;
-
-    if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-        barrier.srcAccessMask = 0;
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-        sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-    } else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-        sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    } else {
-        throw std::invalid_argument("unsupported layout transition!");
-    }
-
-    vkCmdPipelineBarrier(
-        commandBuffer,
-        sourceStage, destinationStage,
-        0,
-        0, nullptr,
-        0, nullptr,
-        1, &barrier
-    );
-
-    renderWindow.endSingleTimeCommands(commandBuffer);
-}
-
-void Texture::copyBufferToImage(RenderWindow& renderWindow, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
-    VkCommandBuffer commandBuffer = renderWindow.beginSingleTimeCommands();
-
-    VkBufferImageCopy region{};
-    region.bufferOffset = 0;
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = 1;
-    region.imageOffset = {0, 0, 0};
-    region.imageExtent = {
-        width,
-        height,
-        1
-    };
-
-    vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-    renderWindow.endSingleTimeCommands(commandBuffer);
-}
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "TransformStore.h"
+
+#include "Application.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+
+// Matrices rebuilt per job, a few pages of positions and rotations
+static constexpr uint32_t UPDATE_GRAIN_SIZE = 4096;
+
+TransformStore::TransformStore(uint32_t capacity)
+{
+
+    m_positions.reserve(capacity);
+    m_rotations.reserve(capacity);
+    m_scales.reserve(capacity);
+    m_worldMatrices.reserve(capacity);
+
+}
+
+uint32_t TransformStore::create()
+{
+
+    if (!m_freeTransforms.empty())
+    {
+        uint32_t transform = m_freeTransforms.back();
+        m_freeTransforms.pop_back();
+        return transform;
+    }
+
+    m_positions.push_back(vec3(0.0f));
+    m_rotations.push_back(quat(1.0f, 0.0f, 0.0f, 0.0f));
+    m_scales.push_back(vec3(1.0f));
+    m_worldMatrices.push_back(mat4(1.0f));
+
+    return static_cast<uint32_t>(m_positions.size() - 1);
+
+}
+
+void TransformStore::release(uint32_t transform)
+{
+
+    // Back to identity so the slot is ready for the next create
+    m_positions[transform] = vec3(0.0f);
+    m_rotations[transform] = quat(1.0f, 0.0f, 0.0f, 0.0f);
+    m_scales[transform] = vec3(1.0f);
+    m_worldMatrices[transform] = mat4(1.0f);
+
+    m_freeTransforms.push_back(transform);
+
+}
+
+vec3 const& TransformStore::getPosition(uint32_t transform) const
+{
+    return m_positions[transform];
+}
+
+quat const& TransformStore::getRotation(uint32_t transform) const
+{
+    return m_rotations[transform];
+}
+
+vec3 const& TransformStore::getScale(uint32_t transform) const
+{
+    return m_scales[transform];
+}
+
+mat4 const& TransformStore::getWorldMatrix(uint32_t transform) const
+{
+    return m_worldMatrices[transform];
+}
+
+void TransformStore::setPosition(uint32_t transform, vec3 const& position)
+{
+    m_positions[transform] = position;
+}
+
+void TransformStore::setRotation(uint32_t transform, quat const& rotation)
+{
+    m_rotations[transform] = rotation;
+}
+
+void TransformStore::setScale(uint32_t transform, vec3 const& scale)
+{
+    m_scales[transform] = scale;
+}
+
+void TransformStore::update(uint32_t transform)
+{
+    updateRange(transform, transform + 1);
+}
+
+void TransformStore::updateAll()
+{
+
+    PROFILE_FUNCTION();
+
+    // Every transform writes its own matrix, the ranges are independent
+    Application::getInstance()->getJobSystem().parallelFor(size(), UPDATE_GRAIN_SIZE,
+        [this](uint32_t begin, uint32_t end) { updateRange(begin, end); });
+
+}
+
+uint32_t TransformStore::size() const
+{
+    return static_cast<uint32_t>(m_positions.size());
+}
+
+void TransformStore::updateRange(uint32_t first, uint32_t end)
+{
+
+    // Translation * rotation * scale written out, no branch and no call so the loop vectorizes
+    for (uint32_t i = first; i < end; i++)
+    {
+        quat const& q = m_rotations[i];
+        vec3 const& s = m_scales[i];
+        vec3 const& p = m_positions[i];
+
+        float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+        float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+        float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+        mat4& m = m_worldMatrices[i];
+        m[0] = vec4((1.0f - 2.0f * (yy + zz)) * s.x, 2.0f * (xy + wz) * s.x, 2.0f * (xz - wy) * s.x, 0.0f);
+        m[1] = vec4(2.0f * (xy - wz) * s.y, (1.0f - 2.0f * (xx + zz)) * s.y, 2.0f * (yz + wx) * s.y, 0.0f);
+        m[2] = vec4(2.0f * (xz + wy) * s.z, 2.0f * (yz - wx) * s.z, (1.0f - 2.0f * (xx + yy)) * s.z, 0.0f);
+        m[3] = vec4(p, 1.0f);
+    }
+
+}
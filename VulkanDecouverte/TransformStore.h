@@ -0,0 +1,42 @@
+#pragma once
+
+#include "framework.h"
+
+// Transforms of every object kept as parallel arrays of positions, rotations, scales
+// and world matrices, so a pass over one of them only touches the memory it needs.
+// Adding a transform can move the arrays, references into them last until the next add.
+class TransformStore
+{
+public:
+    TransformStore(uint32_t capacity = 0);
+
+    // Identity transform, slots of released transforms are reused
+    uint32_t create();
+    void release(uint32_t transform);
+
+    vec3 const& getPosition(uint32_t transform) const;
+    quat const& getRotation(uint32_t transform) const;
+    vec3 const& getScale(uint32_t transform) const;
+    mat4 const& getWorldMatrix(uint32_t transform) const;
+
+    void setPosition(uint32_t transform, vec3 const& position);
+    void setRotation(uint32_t transform, quat const& rotation);
+    void setScale(uint32_t transform, vec3 const& scale);
+
+    // Rebuild the world matrix of one transform, or of all of them in one pass
+    void update(uint32_t transform);
+    void updateAll();
+
+    uint32_t size() const;
+
+private:
+    std::vector<vec3> m_positions;
+    std::vector<quat> m_rotations;
+    std::vector<vec3> m_scales;
+    std::vector<mat4> m_worldMatrices;
+
+    std::vector<uint32_t> m_freeTransforms;
+
+    void updateRange(uint32_t first, uint32_t end);
+
+};
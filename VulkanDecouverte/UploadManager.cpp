@@ -0,0 +1,585 @@
+#include "UploadManager.h"
+
+#include <cassert>
+
+#include "Application.h"
+#include "Profiler.h"
+
+// Satisfies the offset rules of buffer to buffer and buffer to image copies of every format we use
+static constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+// Every stage of the frame that reads uploaded data
+static constexpr VkPipelineStageFlags UPLOAD_CONSUMER_STAGES =
+    VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+static constexpr VkAccessFlags UPLOAD_CONSUMER_ACCESS =
+    VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+UploadManager::UploadManager(VkDevice device, uint32_t transferFamily, VkQueue transferQueue,
+                             uint32_t graphicsFamily, VkQueue graphicsQueue, VkDeviceSize ringSize)
+    : m_device(device), m_transferQueue(transferQueue), m_graphicsQueue(graphicsQueue),
+      m_transferFamily(transferFamily), m_graphicsFamily(graphicsFamily),
+      m_mainThread(std::this_thread::get_id()), m_ringSize(ringSize)
+{
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = m_transferFamily;
+
+    if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload command pool!");
+    }
+
+    if (!isSharedQueue())
+    {
+        poolInfo.queueFamilyIndex = m_graphicsFamily;
+
+        if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_acquireCommandPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create upload acquire command pool!");
+        }
+    }
+
+    Application::getInstance()->createBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        m_ringBuffer, m_ringMemory, m_ringSize);
+
+    // Timestamps only need valid bits on the family running the copies
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(Application::getInstance()->getPhysicalDevice(), &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(Application::getInstance()->getPhysicalDevice(), &queueFamilyCount, queueFamilies.data());
+
+    uint32_t validBits = queueFamilies[m_transferFamily].timestampValidBits;
+    m_timestamps = validBits > 0;
+    m_timestampPeriod = Application::getInstance()->GetPhysicalDeviceProperties().limits.timestampPeriod;
+    m_timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+}
+
+UploadManager::~UploadManager()
+{
+
+    wait(m_nextTicket);
+
+    for (Batch& batch : m_freeBatches) {
+        vkDestroyFence(m_device, batch.fence, nullptr);
+        if (batch.semaphore != VK_NULL_HANDLE) {
+            vkDestroySemaphore(m_device, batch.semaphore, nullptr);
+        }
+        if (batch.queries != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(m_device, batch.queries, nullptr);
+        }
+    }
+
+    vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+    if (m_acquireCommandPool != VK_NULL_HANDLE) {
+        vkDestroyCommandPool(m_device, m_acquireCommandPool, nullptr);
+    }
+    Application::getInstance()->destroyBuffer(m_ringBuffer, m_ringMemory);
+
+}
+
+uint64_t UploadManager::uploadBuffer(VkBuffer destination, void const* data, VkDeviceSize size, VkDeviceSize destinationOffset)
+{
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    auto cpuStart = std::chrono::high_resolution_clock::now();
+
+    VkDeviceSize offset;
+    VkBuffer staging = stage(data, size, offset, lock);
+
+    Batch& batch = getRecordingBatch();
+
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = offset;
+    copyRegion.dstOffset = destinationOffset;
+    copyRegion.size = size;
+    vkCmdCopyBuffer(batch.commandBuffer, staging, destination, 1, &copyRegion);
+
+    if (!isSharedQueue())
+    {
+        VkBufferMemoryBarrier ownership{};
+        ownership.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        ownership.srcQueueFamilyIndex = m_transferFamily;
+        ownership.dstQueueFamilyIndex = m_graphicsFamily;
+        ownership.buffer = destination;
+        ownership.offset = destinationOffset;
+        ownership.size = size;
+        batch.bufferOwnership.push_back(ownership);
+    }
+
+    batch.copyCount++;
+    m_timings.cpuTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - cpuStart).count();
+    return batch.ticket;
+
+}
+
+uint64_t UploadManager::uploadImage(VkImage destination, uint32_t width, uint32_t height, void const* data, VkDeviceSize size)
+{
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    auto cpuStart = std::chrono::high_resolution_clock::now();
+
+    VkDeviceSize offset;
+    VkBuffer staging = stage(data, size, offset, lock);
+
+    Batch& batch = getRecordingBatch();
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = destination;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = offset;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = { 0, 0, 0 };
+    region.imageExtent = { width, height, 1 };
+
+    vkCmdCopyBufferToImage(batch.commandBuffer, staging, destination, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    if (isSharedQueue())
+    {
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+    else
+    {
+        // The layout transition is part of the ownership transfer, both sides must declare it
+        barrier.srcQueueFamilyIndex = m_transferFamily;
+        barrier.dstQueueFamilyIndex = m_graphicsFamily;
+        batch.imageOwnership.push_back(barrier);
+    }
+
+    batch.copyCount++;
+    m_timings.cpuTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - cpuStart).count();
+    return batch.ticket;
+
+}
+
+void UploadManager::submit()
+{
+
+    PROFILE_FUNCTION();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    submitLocked();
+
+}
+
+void UploadManager::submitLocked()
+{
+
+    // The queues are also used by the frame submits and presents, none of them is guarded
+    assert(std::this_thread::get_id() == m_mainThread && "uploads are only submitted from the main thread");
+
+    m_submitRequested = false;
+    if (m_recording.commandBuffer == VK_NULL_HANDLE) return;
+
+    if (m_recording.timed) {
+        vkCmdWriteTimestamp(m_recording.commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_recording.queries, m_recording.queryPair * 2 + 1);
+    }
+
+    if (isSharedQueue())
+    {
+        // Copies are visible to every command submitted after this batch on the queue,
+        // the frames drawing with these resources need nothing else
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = UPLOAD_CONSUMER_ACCESS;
+
+        vkCmdPipelineBarrier(m_recording.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, UPLOAD_CONSUMER_STAGES,
+            0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+    else
+    {
+        // Release half of the ownership transfer, the destination access is ignored on this side
+        for (VkBufferMemoryBarrier& release : m_recording.bufferOwnership) {
+            release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            release.dstAccessMask = 0;
+        }
+        for (VkImageMemoryBarrier& release : m_recording.imageOwnership) {
+            release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            release.dstAccessMask = 0;
+        }
+
+        vkCmdPipelineBarrier(m_recording.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+            0, nullptr,
+            static_cast<uint32_t>(m_recording.bufferOwnership.size()), m_recording.bufferOwnership.data(),
+            static_cast<uint32_t>(m_recording.imageOwnership.size()), m_recording.imageOwnership.data());
+    }
+
+    if (vkEndCommandBuffer(m_recording.commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record upload command buffer!");
+    }
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &m_recording.commandBuffer;
+
+    if (isSharedQueue())
+    {
+        if (vkQueueSubmit(m_transferQueue, 1, &submitInfo, m_recording.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit upload command buffer!");
+        }
+    }
+    else
+    {
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &m_recording.semaphore;
+
+        if (vkQueueSubmit(m_transferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit upload command buffer!");
+        }
+
+        // Acquire half, only this small batch waits on the copies, the frames after it
+        // are held by its barrier at the stages reading the data and nowhere else
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        vkBeginCommandBuffer(m_recording.acquireCommandBuffer, &beginInfo);
+
+        for (VkBufferMemoryBarrier& acquire : m_recording.bufferOwnership) {
+            acquire.srcAccessMask = 0;
+            acquire.dstAccessMask = UPLOAD_CONSUMER_ACCESS;
+        }
+        for (VkImageMemoryBarrier& acquire : m_recording.imageOwnership) {
+            acquire.srcAccessMask = 0;
+            acquire.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        }
+
+        vkCmdPipelineBarrier(m_recording.acquireCommandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, UPLOAD_CONSUMER_STAGES, 0,
+            0, nullptr,
+            static_cast<uint32_t>(m_recording.bufferOwnership.size()), m_recording.bufferOwnership.data(),
+            static_cast<uint32_t>(m_recording.imageOwnership.size()), m_recording.imageOwnership.data());
+
+        // The pair of the next use of the batch, the one written now is read on retire
+        if (m_recording.queries != VK_NULL_HANDLE)
+        {
+            if (m_recording.queryUses == 0) {
+                vkCmdResetQueryPool(m_recording.acquireCommandBuffer, m_recording.queries, 0, 4);
+            }
+            else {
+                vkCmdResetQueryPool(m_recording.acquireCommandBuffer, m_recording.queries, (1 - m_recording.queryPair) * 2, 2);
+            }
+        }
+
+        if (vkEndCommandBuffer(m_recording.acquireCommandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record upload acquire command buffer!");
+        }
+
+        VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+        VkSubmitInfo acquireInfo{};
+        acquireInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        acquireInfo.waitSemaphoreCount = 1;
+        acquireInfo.pWaitSemaphores = &m_recording.semaphore;
+        acquireInfo.pWaitDstStageMask = &waitStage;
+        acquireInfo.commandBufferCount = 1;
+        acquireInfo.pCommandBuffers = &m_recording.acquireCommandBuffer;
+
+        // The acquire runs after the copies, its fence covers the whole batch
+        if (vkQueueSubmit(m_graphicsQueue, 1, &acquireInfo, m_recording.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit upload acquire command buffer!");
+        }
+    }
+
+    m_recording.queryUses++;
+    m_recording.ringEnd = m_ringHead;
+    m_inFlight.push_back(std::move(m_recording));
+    m_recording = Batch{};
+
+    m_submitted.notify_all();
+
+}
+
+void UploadManager::collect()
+{
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    collectLocked();
+
+}
+
+void UploadManager::collectLocked()
+{
+
+    // Batches run in submission order, stop at the first one still running
+    while (!m_inFlight.empty() && vkGetFenceStatus(m_device, m_inFlight.front().fence) == VK_SUCCESS)
+    {
+        retire(m_inFlight.front());
+        m_inFlight.pop_front();
+    }
+
+}
+
+bool UploadManager::isComplete(uint64_t ticket)
+{
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (ticket <= m_completedTicket) return true;
+
+    collectLocked();
+    return ticket <= m_completedTicket;
+
+}
+
+void UploadManager::wait(uint64_t ticket)
+{
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    waitLocked(ticket, lock);
+
+}
+
+void UploadManager::waitLocked(uint64_t ticket, std::unique_lock<std::mutex>& lock)
+{
+
+    if (m_recording.commandBuffer != VK_NULL_HANDLE && ticket >= m_recording.ticket)
+    {
+        if (std::this_thread::get_id() == m_mainThread)
+        {
+            submitLocked();
+        }
+        else
+        {
+            // The main loop submits at the end of the frame, a main thread waiting on
+            // a job runs the main thread jobs, this one makes sure it does not wait on us
+            if (!m_submitRequested)
+            {
+                m_submitRequested = true;
+                Application::getInstance()->getJobSystem().scheduleOnMainThread([this]() { submit(); });
+            }
+
+            m_submitted.wait(lock, [this, ticket]() {
+                return m_recording.commandBuffer == VK_NULL_HANDLE || m_recording.ticket > ticket;
+            });
+        }
+    }
+
+    while (!m_inFlight.empty() && m_inFlight.front().ticket <= ticket)
+    {
+        vkWaitForFences(m_device, 1, &m_inFlight.front().fence, VK_TRUE, UINT64_MAX);
+        retire(m_inFlight.front());
+        m_inFlight.pop_front();
+    }
+
+}
+
+UploadManager::Timings UploadManager::takeTimings()
+{
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Timings timings = m_timings;
+    m_timings = Timings{};
+    return timings;
+
+}
+
+bool UploadManager::isSharedQueue() const
+{
+    return m_transferFamily == m_graphicsFamily;
+}
+
+UploadManager::Batch& UploadManager::getRecordingBatch()
+{
+
+    if (m_recording.commandBuffer != VK_NULL_HANDLE) return m_recording;
+
+    if (!m_freeBatches.empty())
+    {
+        m_recording = std::move(m_freeBatches.back());
+        m_freeBatches.pop_back();
+
+        vkResetFences(m_device, 1, &m_recording.fence);
+        vkResetCommandBuffer(m_recording.commandBuffer, 0);
+        if (m_recording.acquireCommandBuffer != VK_NULL_HANDLE) {
+            vkResetCommandBuffer(m_recording.acquireCommandBuffer, 0);
+        }
+    }
+    else
+    {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = m_commandPool;
+        allocInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(m_device, &allocInfo, &m_recording.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate upload command buffer!");
+        }
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        if (vkCreateFence(m_device, &fenceInfo, nullptr, &m_recording.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create upload fence!");
+        }
+
+        if (!isSharedQueue())
+        {
+            allocInfo.commandPool = m_acquireCommandPool;
+
+            if (vkAllocateCommandBuffers(m_device, &allocInfo, &m_recording.acquireCommandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate upload acquire command buffer!");
+            }
+
+            VkSemaphoreCreateInfo semaphoreInfo{};
+            semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+            if (vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_recording.semaphore) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create upload semaphore!");
+            }
+        }
+
+        if (m_timestamps)
+        {
+            VkQueryPoolCreateInfo queryPoolInfo{};
+            queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            queryPoolInfo.queryCount = 4;
+
+            if (vkCreateQueryPool(m_device, &queryPoolInfo, nullptr, &m_recording.queries) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create upload timestamp query pool!");
+            }
+        }
+    }
+
+    m_recording.ticket = m_nextTicket++;
+    m_recording.copyCount = 0;
+    m_recording.overflowBuffers.clear();
+    m_recording.bufferOwnership.clear();
+    m_recording.imageOwnership.clear();
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(m_recording.commandBuffer, &beginInfo);
+
+    // A transfer only family cannot reset queries, the graphics side acquire resets the pair
+    // of the next use instead, so the first use of such a batch only prepares its queries
+    if (m_recording.queries != VK_NULL_HANDLE)
+    {
+        if (isSharedQueue()) {
+            m_recording.queryPair = 0;
+            m_recording.timed = true;
+            vkCmdResetQueryPool(m_recording.commandBuffer, m_recording.queries, 0, 2);
+        }
+        else {
+            m_recording.queryPair = m_recording.queryUses % 2;
+            m_recording.timed = m_recording.queryUses > 0;
+        }
+
+        if (m_recording.timed) {
+            vkCmdWriteTimestamp(m_recording.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_recording.queries, m_recording.queryPair * 2);
+        }
+    }
+
+    return m_recording;
+
+}
+
+VkBuffer UploadManager::stage(void const* data, VkDeviceSize size, VkDeviceSize& offset, std::unique_lock<std::mutex>& lock)
+{
+
+    if (size > m_ringSize)
+    {
+        std::pair<VkBuffer, Allocation> overflow;
+        Application::getInstance()->createBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            overflow.first, overflow.second, size);
+
+        memcpy(overflow.second.mapped, data, size);
+
+        getRecordingBatch().overflowBuffers.push_back(overflow);
+        offset = 0;
+        return overflow.first;
+    }
+
+    while (true)
+    {
+        VkDeviceSize start = (m_ringHead + STAGING_ALIGNMENT - 1) / STAGING_ALIGNMENT * STAGING_ALIGNMENT;
+
+        // Never split a copy across the end of the ring
+        if (start % m_ringSize + size > m_ringSize) {
+            start += m_ringSize - start % m_ringSize;
+        }
+
+        if (start + size - m_ringTail <= m_ringSize)
+        {
+            m_ringHead = start + size;
+            offset = start % m_ringSize;
+            memcpy(static_cast<char*>(m_ringMemory.mapped) + offset, data, size);
+            return m_ringBuffer;
+        }
+
+        // The ring is full: free what is done, otherwise wait for the oldest batch,
+        // the recording one when nothing is in flight. The head is read again after the
+        // wait, other threads may have staged while a job waited for the main thread
+        collectLocked();
+        if (start + size - m_ringTail <= m_ringSize) continue;
+
+        if (m_inFlight.empty() && m_recording.commandBuffer == VK_NULL_HANDLE) {
+            throw std::runtime_error("upload ring is too small for this upload!");
+        }
+        waitLocked(m_inFlight.empty() ? m_recording.ticket : m_inFlight.front().ticket, lock);
+    }
+
+}
+
+void UploadManager::retire(Batch& batch)
+{
+
+    for (auto& overflow : batch.overflowBuffers) {
+        Application::getInstance()->destroyBuffer(overflow.first, overflow.second);
+    }
+    batch.overflowBuffers.clear();
+
+    if (batch.timed)
+    {
+        uint64_t timestamps[2] = {};
+        if (vkGetQueryPoolResults(m_device, batch.queries, batch.queryPair * 2, 2, sizeof(timestamps), timestamps,
+            sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+            m_timings.gpuTime += (double)((timestamps[1] - timestamps[0]) & m_timestampMask) * m_timestampPeriod / 1000000.0;
+        }
+    }
+    m_timings.batchCount++;
+
+    m_ringTail = std::max(m_ringTail, batch.ringEnd);
+    m_completedTicket = std::max(m_completedTicket, batch.ticket);
+
+    m_freeBatches.push_back(std::move(batch));
+
+}
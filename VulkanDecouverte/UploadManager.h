@@ -0,0 +1,130 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "framework.h"
+
+#include "MemoryAllocator.h"
+
+// Batches buffer and image uploads into one submission per frame. Data is copied
+// into a persistently mapped staging ring, the copies are recorded into the
+// current batch and each submitted batch is tracked by a fence, so the ring
+// space comes back without ever waiting on the queue.
+// When the transfer family differs from the graphics one, the copies run on the
+// transfer queue and the resources are handed over to the graphics family: the
+// release barriers close the transfer batch, a small graphics batch waits on its
+// semaphore and acquires them before any later frame reads them.
+// A timestamp pair is written around the copies of every batch, the finished batches
+// are reported by the GPU profiler as its "Uploads" entry.
+// Uploads can be recorded from any thread but only the main thread submits, the queues
+// are shared with the frames. A job waiting on a batch asks the main thread to send it.
+class UploadManager
+{
+public:
+    struct Timings
+    {
+        uint32_t batchCount = 0;
+        double cpuTime = 0.0; // ms spent staging and recording copies
+        double gpuTime = 0.0; // ms between the timestamps of the batches, 0 without timestamps
+    };
+
+    UploadManager(VkDevice device, uint32_t transferFamily, VkQueue transferQueue,
+                  uint32_t graphicsFamily, VkQueue graphicsQueue, VkDeviceSize ringSize = DEFAULT_RING_SIZE);
+    ~UploadManager();
+
+    // Both return the ticket of the batch the copy was recorded into.
+    // The whole destination range is written, its previous content is not kept across queues
+    uint64_t uploadBuffer(VkBuffer destination, void const* data, VkDeviceSize size, VkDeviceSize destinationOffset = 0);
+    // Leaves the image in SHADER_READ_ONLY_OPTIMAL
+    uint64_t uploadImage(VkImage destination, uint32_t width, uint32_t height, void const* data, VkDeviceSize size);
+
+    // Send the recorded copies to the queue, called once per frame before the frame submit.
+    // Main thread only
+    void submit();
+    // Give back the ring space and command buffers of the finished batches
+    void collect();
+
+    bool isComplete(uint64_t ticket);
+    // Off the main thread, blocks until the main thread submitted the batch of the ticket
+    void wait(uint64_t ticket);
+
+    // Timings of the batches retired since the last call
+    Timings takeTimings();
+
+    static constexpr VkDeviceSize DEFAULT_RING_SIZE = 32ull * 1024 * 1024;
+
+private:
+    struct Batch
+    {
+        uint64_t ticket = 0;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        // Only used when the copies do not run on the graphics family
+        VkCommandBuffer acquireCommandBuffer = VK_NULL_HANDLE;
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+        std::vector<VkBufferMemoryBarrier> bufferOwnership;
+        std::vector<VkImageMemoryBarrier> imageOwnership;
+        // Ring position reached by this batch, everything before it is free once it is done
+        VkDeviceSize ringEnd = 0;
+        // Uploads bigger than the ring get their own staging buffer
+        std::vector<std::pair<VkBuffer, Allocation>> overflowBuffers;
+        uint32_t copyCount = 0;
+        // Two timestamp pairs used in turn, see getRecordingBatch
+        VkQueryPool queries = VK_NULL_HANDLE;
+        uint32_t queryUses = 0;
+        uint32_t queryPair = 0;
+        bool timed = false;
+    };
+
+    VkDevice m_device;
+    VkQueue m_transferQueue;
+    VkQueue m_graphicsQueue;
+    uint32_t m_transferFamily;
+    uint32_t m_graphicsFamily;
+    VkCommandPool m_commandPool;
+    VkCommandPool m_acquireCommandPool = VK_NULL_HANDLE;
+
+    std::mutex m_mutex;
+    // Notified at every submit, for the jobs waiting on the recording batch
+    std::condition_variable m_submitted;
+    bool m_submitRequested = false;
+    // The thread creating the manager, the only one allowed to submit
+    std::thread::id m_mainThread;
+
+    VkBuffer m_ringBuffer;
+    Allocation m_ringMemory;
+    VkDeviceSize m_ringSize;
+    // Monotonic positions, the ring offset is position % m_ringSize
+    VkDeviceSize m_ringHead = 0;
+    VkDeviceSize m_ringTail = 0;
+
+    Batch m_recording;
+    std::deque<Batch> m_inFlight;
+    std::vector<Batch> m_freeBatches;
+
+    uint64_t m_nextTicket = 1;
+    uint64_t m_completedTicket = 0;
+
+    bool m_timestamps = false;
+    double m_timestampPeriod = 0.0;
+    uint64_t m_timestampMask = ~0ull;
+    Timings m_timings;
+
+    bool isSharedQueue() const;
+
+    // The same as the public functions, with the lock already taken
+    void submitLocked();
+    void collectLocked();
+    // Can let go of the lock while waiting for the main thread
+    void waitLocked(uint64_t ticket, std::unique_lock<std::mutex>& lock);
+
+    Batch& getRecordingBatch();
+    // Reserve staging space, returns the buffer and offset the data was written to
+    VkBuffer stage(void const* data, VkDeviceSize size, VkDeviceSize& offset, std::unique_lock<std::mutex>& lock);
+    void retire(Batch& batch);
+
+};
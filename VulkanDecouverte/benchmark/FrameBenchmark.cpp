@@ -0,0 +1,254 @@
+#include "FrameBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "../GeometryFactory.h"
+#include "../GpuScene.h"
+#include "../Mesh.h"
+#include "../RenderObject.h"
+#include "../RenderPipeline.h"
+#include "../GpuProfiler.h"
+#include "../Profiler.h"
+#include "../Shader.h"
+
+// One full turn of the camera every CAMERA_ORBIT_FRAMES, independent of the frame count
+static constexpr uint32_t CAMERA_ORBIT_FRAMES = 600;
+static constexpr float CUBE_SPACING = 2.0f;
+
+FrameBenchmark::Settings FrameBenchmark::Settings::FromCommandLine(std::string const& commandLine)
+{
+
+    Settings settings;
+
+    std::istringstream stream(commandLine);
+    std::string argument;
+    while (stream >> argument)
+    {
+        if (argument == "--cubes") stream >> settings.cubeCount;
+        else if (argument == "--frames") stream >> settings.frameCount;
+        else if (argument == "--warmup") stream >> settings.warmupFrames;
+        else if (argument == "--width") stream >> settings.width;
+        else if (argument == "--height") stream >> settings.height;
+        else if (argument == "--output") stream >> settings.outputPath;
+        else if (argument == "--gpu-culling") settings.gpuCulling = true;
+    }
+
+    return settings;
+
+}
+
+FrameBenchmark::Percentiles FrameBenchmark::Percentiles::Compute(std::vector<double> samples)
+{
+
+    Percentiles result;
+    if (samples.empty()) return result;
+
+    std::sort(samples.begin(), samples.end());
+
+    // Nearest rank, so every reported value is a frame that really happened
+    auto rank = [&samples](double percentile) {
+        size_t index = (size_t)std::ceil(percentile / 100.0 * (double)samples.size());
+        return samples[std::clamp<size_t>(index, 1, samples.size()) - 1];
+    };
+
+    double sum = 0.0;
+    for (double sample : samples) sum += sample;
+
+    result.samples = samples.size();
+    result.min = samples.front();
+    result.max = samples.back();
+    result.mean = sum / (double)samples.size();
+    result.p50 = rank(50.0);
+    result.p95 = rank(95.0);
+    result.p99 = rank(99.0);
+
+    return result;
+
+}
+
+FrameBenchmark::FrameBenchmark(Settings const& settings)
+    : RenderTexture(settings.width, settings.height), m_settings(settings), m_transforms(settings.cubeCount)
+{
+
+    m_renderPipeline = &getPipeline(getPipelineDescription());
+
+    m_mesh = getMeshCache().loadPrimitive(Primitive::CUBE);
+    Mesh* mesh = m_mesh.get();
+
+    // Cubes on a grid centered on the origin, always laid out in the same order
+    uint32_t side = (uint32_t)std::ceil(std::cbrt((double)std::max(m_settings.cubeCount, 1u)));
+    float offset = (float)(side - 1) * CUBE_SPACING * 0.5f;
+
+    m_objects.reserve(m_settings.cubeCount);
+    for (uint32_t i = 0; i < m_settings.cubeCount; i++)
+    {
+        vec3 cell = vec3((float)(i % side), (float)((i / side) % side), (float)(i / (side * side)));
+
+        RenderObject* object = new RenderObject(mesh, m_transforms);
+        object->setPosition(cell * CUBE_SPACING - vec3(offset));
+        m_objects.push_back(object);
+    }
+
+    m_transforms.updateAll();
+
+    m_sceneRadius = offset * 1.75f + 5.0f;
+
+    if (m_settings.gpuCulling)
+    {
+        m_gpuScene = new GpuScene(*this, std::max(m_settings.cubeCount, 1u));
+        for (RenderObject* object : m_objects) {
+            m_gpuScene->addObject(*mesh, object->getTransform());
+        }
+        setGpuScene(m_gpuScene);
+    }
+
+}
+
+FrameBenchmark::~FrameBenchmark()
+{
+
+    waitIdle();
+
+    setGpuScene(nullptr);
+    delete m_gpuScene;
+
+    for (RenderObject* object : m_objects) delete object;
+
+}
+
+void FrameBenchmark::run()
+{
+
+    uint32_t totalFrames = m_settings.warmupFrames + m_settings.frameCount;
+
+    m_cpuFrameTimes.clear();
+    m_fenceWaitTimes.clear();
+    m_gpuFrameTimes.clear();
+    m_cpuFrameTimes.reserve(m_settings.frameCount);
+    m_fenceWaitTimes.reserve(m_settings.frameCount);
+    m_gpuFrameTimes.reserve(m_settings.frameCount);
+
+    for (uint32_t frame = 0; frame < totalFrames; frame++)
+    {
+
+        auto frameStart = std::chrono::high_resolution_clock::now();
+        drawFrame(frame);
+        double cpuTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - frameStart).count();
+
+        if (frame < m_settings.warmupFrames) continue;
+
+        m_cpuFrameTimes.push_back(cpuTime);
+        m_fenceWaitTimes.push_back(getFenceWaitTime());
+        m_drawStats = getDrawStats();
+
+        // GPU time comes from the frame that last used this slot, MAX_FRAMES_IN_FLIGHT frames ago
+        if (hasGpuFrameTime()) {
+            m_gpuFrameTimes.push_back(getGpuFrameTime());
+        }
+
+    }
+
+    waitIdle();
+
+}
+
+void FrameBenchmark::drawFrame(uint32_t frameIndex)
+{
+
+    PROFILE_FUNCTION();
+
+    moveCamera(frameIndex);
+
+    update();
+
+    clear();
+
+    if (m_gpuScene != nullptr) {
+        drawScene(*m_renderPipeline);
+    } else {
+        drawObjects(*m_renderPipeline, m_objects);
+    }
+
+    display();
+
+}
+
+void FrameBenchmark::moveCamera(uint32_t frameIndex)
+{
+
+    float angle = (float)(frameIndex % CAMERA_ORBIT_FRAMES) / (float)CAMERA_ORBIT_FRAMES * 2.0f * pi<float>();
+
+    vec3 position = vec3(std::cos(angle) * m_sceneRadius, m_sceneRadius * 0.5f, std::sin(angle) * m_sceneRadius);
+    setCamera(position, vec3(0.0f));
+
+}
+
+static void writePercentiles(std::ostream& out, const char* name, FrameBenchmark::Percentiles const& stats, bool last)
+{
+    out << "    \"" << name << "\": { "
+        << "\"samples\": " << stats.samples << ", "
+        << "\"min\": " << stats.min << ", "
+        << "\"mean\": " << stats.mean << ", "
+        << "\"p50\": " << stats.p50 << ", "
+        << "\"p95\": " << stats.p95 << ", "
+        << "\"p99\": " << stats.p99 << ", "
+        << "\"max\": " << stats.max << " }"
+        << (last ? "\n" : ",\n");
+}
+
+void FrameBenchmark::writeReport()
+{
+
+    std::ofstream file(m_settings.outputPath, std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open benchmark report " + m_settings.outputPath);
+    }
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(4);
+
+    out << "{\n";
+    out << "  \"device\": \"" << Application::getInstance()->GetPhysicalDeviceProperties().deviceName << "\",\n";
+    out << "  \"cubes\": " << m_settings.cubeCount << ",\n";
+    out << "  \"width\": " << m_settings.width << ",\n";
+    out << "  \"height\": " << m_settings.height << ",\n";
+    out << "  \"warmup_frames\": " << m_settings.warmupFrames << ",\n";
+    out << "  \"frames\": " << m_settings.frameCount << ",\n";
+    out << "  \"gpu_culling\": " << (m_settings.gpuCulling ? "true" : "false") << ",\n";
+    out << "  \"gpu_timestamps\": " << (m_gpuProfiler->isSupported() ? "true" : "false") << ",\n";
+    out << "  \"timings_ms\": {\n";
+    writePercentiles(out, "cpu_frame", Percentiles::Compute(m_cpuFrameTimes), false);
+    writePercentiles(out, "fence_wait", Percentiles::Compute(m_fenceWaitTimes), false);
+    writePercentiles(out, "gpu_frame", Percentiles::Compute(m_gpuFrameTimes), true);
+    out << "  },\n";
+    out << "  \"draws\": { \"packets\": " << m_drawStats.packets
+        << ", \"culled\": " << m_drawStats.culled
+        << ", \"draw_calls\": " << m_drawStats.drawCalls
+        << ", \"binds_elided\": " << m_drawStats.bindsElided << " },\n";
+
+    std::vector<MemoryAllocator::HeapStats> heaps = Application::getInstance()->getAllocator().getHeapStats();
+    out << "  \"memory_heaps\": [\n";
+    for (size_t heap = 0; heap < heaps.size(); heap++)
+    {
+        MemoryAllocator::HeapStats const& stats = heaps[heap];
+        out << "    { \"heap\": " << heap
+            << ", \"reserved\": " << stats.reserved
+            << ", \"used\": " << stats.used
+            << ", \"blocks\": " << stats.blockCount
+            << ", \"dedicated\": " << stats.dedicatedCount
+            << ", \"allocations\": " << stats.allocationCount
+            << ", \"fragmentation\": " << stats.fragmentation << " }"
+            << (heap + 1 < heaps.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n";
+    out << "}\n";
+
+    file << out.str();
+    std::cout << out.str();
+
+}
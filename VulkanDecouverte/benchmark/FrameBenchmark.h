@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+
+#include "../MeshCache.h"
+#include "../RenderTexture.h"
+#include "../TransformStore.h"
+
+class GpuScene;
+class RenderObject;
+class RenderPipeline;
+
+// Headless and deterministic frame benchmark: a fixed grid of cubes, a camera
+// following a fixed orbit and a fixed number of frames, so two runs on the same
+// machine can be compared number to number.
+class FrameBenchmark final : public RenderTexture
+{
+public:
+    struct Settings
+    {
+        uint32_t cubeCount = 100;
+        uint32_t warmupFrames = 60;
+        uint32_t frameCount = 1000;
+        int width = 1280;
+        int height = 720;
+        std::string outputPath = "benchmark.json";
+        // Cull and draw the cubes from a GPU scene instead of the render queue
+        bool gpuCulling = false;
+
+        // Reads "--cubes N --frames N --warmup N --width N --height N --output path --gpu-culling"
+        static Settings FromCommandLine(std::string const& commandLine);
+    };
+
+    struct Percentiles
+    {
+        size_t samples = 0;
+        double min = 0.0;
+        double mean = 0.0;
+        double p50 = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+
+        static Percentiles Compute(std::vector<double> samples);
+    };
+
+    FrameBenchmark(Settings const& settings);
+    ~FrameBenchmark() override;
+
+    void run();
+    void writeReport();
+
+private:
+    Settings m_settings;
+
+    // Released after the objects, before the context and its mesh cache go away
+    MeshHandle m_mesh;
+    // Owned by the pipeline registry of the context
+    RenderPipeline* m_renderPipeline;
+    TransformStore m_transforms;
+    std::vector<RenderObject*> m_objects;
+    GpuScene* m_gpuScene = nullptr;
+
+    float m_sceneRadius = 0.0f;
+
+    std::vector<double> m_cpuFrameTimes;
+    std::vector<double> m_fenceWaitTimes;
+    std::vector<double> m_gpuFrameTimes;
+    // Every measured frame draws the same scene, the counters of the last one stand for all
+    RenderQueue::Stats m_drawStats;
+
+    void drawFrame(uint32_t frameIndex);
+    void moveCamera(uint32_t frameIndex);
+
+};
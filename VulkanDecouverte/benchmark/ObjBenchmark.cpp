@@ -0,0 +1,274 @@
+#include "ObjBenchmark.h"
+
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <unordered_map>
+
+#include "FrameBenchmark.h"
+#include "../JobSystem.h"
+#include "../Mesh.h"
+#include "../ObjParser.h"
+
+// The OBJ loader of GeometryFactory before ObjParser, unchanged apart from the path
+static MeshData* parseObjLegacy(std::filesystem::path const& path, bool invertV)
+{
+
+	MeshData* data = new MeshData();
+	
+	std::fstream meshFile;
+	meshFile.open(path, std::ios::in);
+	
+	std::vector<vec2> tempTexCoords;
+	std::vector<vec3> tempPosition;
+	std::vector<vec3> tempNormal;
+	std::unordered_map<std::string, int> vertexCache;  // Maps "v/vt/vn" to a unique index
+
+	for(std::string line; std::getline(meshFile, line); )   // Read stream line by line
+	{
+	    std::istringstream in(line);      
+	    std::string type;
+	    in >> type;
+
+	    if(type == "v") 
+	    {
+	        float x, y, z;
+	        in >> x >> y >> z;
+	    	tempPosition.push_back({x,y,z});
+	    } 
+	    else if (type == "vn") 
+	    {
+	        float x, y, z;
+	        in >> x >> y >> z;
+	        tempNormal.push_back({x, y, z});
+	    } 
+	    else if (type == "vt") 
+	    { 
+	        float u, v;
+	        in >> u >> v;
+	        tempTexCoords.push_back( vec2(u, invertV ? 1 -v : v) ); // Flip V to match DirectX/OpenGL convention
+	    } 
+	    else if (type == "f") 
+	    {
+	        std::vector<int> faceIndices;
+	        std::string indicesString;
+
+	        while (in >> indicesString) 
+	        {
+	            std::istringstream indices(indicesString);
+	            std::string vIndex, vtIndex, vnIndex;
+	            int v = -1, vt = -1, vn = -1;
+
+	            std::getline(indices, vIndex, '/');  
+	            if (!vIndex.empty()) v = std::stoi(vIndex) - 1;
+
+	            if (std::getline(indices, vtIndex, '/')) 
+	                if (!vtIndex.empty()) vt = std::stoi(vtIndex) - 1;
+
+	            if (std::getline(indices, vnIndex, '/')) 
+	                if (!vnIndex.empty()) vn = std::stoi(vnIndex) - 1;
+
+	            // Create a unique key for this combination of v/vt/vn
+	            std::string key = vIndex + "/" + vtIndex + "/" + vnIndex;
+
+	            // Check if we've already created this vertex
+	            if (!vertexCache.contains(key)) 
+	            {
+	                Vertex newVertex; // Copy position
+	            	if (v != -1 && v < tempPosition.size()) newVertex.position = tempPosition[v];
+	            	if (vn != -1 && vn < tempNormal.size()) newVertex.normal = tempNormal[vn];
+	            	if (vt != -1 && vt < tempTexCoords.size()) newVertex.texCoords = tempTexCoords[vt];
+
+	                data->Vertices.push_back(newVertex);
+	                vertexCache[key] = data->Vertices.size() - 1;
+	            }
+
+	            // Store the correct index
+	            faceIndices.push_back(vertexCache[key]);
+	        }
+
+	        // Handle triangulation for quads
+	        if (faceIndices.size() == 3) {
+	            data->Indices.push_back(faceIndices[0]);
+	            data->Indices.push_back(faceIndices[1]);
+	            data->Indices.push_back(faceIndices[2]);
+	        } 
+	        else if (faceIndices.size() == 4) {
+	            // Convert quad to two triangles
+	            data->Indices.push_back(faceIndices[0]);
+	            data->Indices.push_back(faceIndices[1]);
+	            data->Indices.push_back(faceIndices[2]);
+
+	            data->Indices.push_back(faceIndices[0]);
+	            data->Indices.push_back(faceIndices[2]);
+	            data->Indices.push_back(faceIndices[3]);
+	        }
+	    }
+	}
+
+
+	meshFile.close();
+	
+	return data;
+}
+
+static bool sameMesh(MeshData const& a, MeshData const& b)
+{
+
+    if (a.Vertices.size() != b.Vertices.size() || a.Indices != b.Indices) return false;
+
+    for (size_t i = 0; i < a.Vertices.size(); i++)
+    {
+        Vertex const& left = a.Vertices[i];
+        Vertex const& right = b.Vertices[i];
+        if (left.position != right.position || left.normal != right.normal || left.texCoords != right.texCoords) return false;
+    }
+
+    return true;
+
+}
+
+ObjBenchmark::Settings ObjBenchmark::Settings::FromCommandLine(std::string const& commandLine)
+{
+
+    Settings settings;
+
+    std::istringstream stream(commandLine);
+    std::string argument;
+    while (stream >> argument)
+    {
+        if (argument == "--obj") stream >> settings.objPath;
+        else if (argument == "--faces") stream >> settings.faceCount;
+        else if (argument == "--runs") stream >> settings.runs;
+        else if (argument == "--output") stream >> settings.outputPath;
+    }
+
+    return settings;
+
+}
+
+ObjBenchmark::ObjBenchmark(Settings const& settings)
+    : m_settings(settings)
+{
+}
+
+void ObjBenchmark::run()
+{
+
+    std::string path = m_settings.objPath;
+    if (path.empty())
+    {
+        path = "obj_benchmark_" + std::to_string(m_settings.faceCount) + ".obj";
+        if (!std::filesystem::exists(path)) generateModel(path);
+    }
+
+    m_fileSize = static_cast<size_t>(std::filesystem::file_size(path));
+
+    // Workers of its own, Application is not initialized for this run
+    JobSystem jobs;
+
+    using Clock = std::chrono::steady_clock;
+    auto milliseconds = [](Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+
+    // Alternated so both see the same page cache state
+    for (uint32_t run = 0; run < m_settings.runs; run++)
+    {
+        Clock::time_point start = Clock::now();
+        MeshData* legacy = parseObjLegacy(path, true);
+        m_legacyTimes.push_back(milliseconds(start));
+
+        start = Clock::now();
+        MeshData* parallel = ObjParser::Parse(path, true, jobs);
+        m_parallelTimes.push_back(milliseconds(start));
+
+        m_vertexCount = parallel->Vertices.size();
+        m_indexCount = parallel->Indices.size();
+        m_identical = m_identical && sameMesh(*legacy, *parallel);
+
+        delete legacy;
+        delete parallel;
+    }
+
+}
+
+void ObjBenchmark::writeReport()
+{
+
+    std::ofstream file(m_settings.outputPath, std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open benchmark report " + m_settings.outputPath);
+    }
+
+    FrameBenchmark::Percentiles legacy = FrameBenchmark::Percentiles::Compute(m_legacyTimes);
+    FrameBenchmark::Percentiles parallel = FrameBenchmark::Percentiles::Compute(m_parallelTimes);
+
+    auto writeTimes = [](std::ostringstream& out, char const* name, FrameBenchmark::Percentiles const& values, bool last) {
+        out << "    \"" << name << "\": { \"min\": " << values.min << ", \"mean\": " << values.mean
+            << ", \"p50\": " << values.p50 << ", \"max\": " << values.max << " }" << (last ? "\n" : ",\n");
+    };
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(4);
+
+    out << "{\n";
+    out << "  \"file_bytes\": " << m_fileSize << ",\n";
+    out << "  \"runs\": " << m_settings.runs << ",\n";
+    out << "  \"vertices\": " << m_vertexCount << ",\n";
+    out << "  \"triangles\": " << m_indexCount / 3 << ",\n";
+    out << "  \"identical\": " << (m_identical ? "true" : "false") << ",\n";
+    out << "  \"timings_ms\": {\n";
+    writeTimes(out, "legacy", legacy, false);
+    writeTimes(out, "parallel", parallel, true);
+    out << "  },\n";
+    out << "  \"speedup\": " << (parallel.p50 > 0.0 ? legacy.p50 / parallel.p50 : 0.0) << ",\n";
+    out << "  \"parallel_mb_per_s\": " << (parallel.p50 > 0.0 ? m_fileSize / (parallel.p50 * 1000.0) : 0.0) << "\n";
+    out << "}\n";
+
+    file << out.str();
+    std::cout << out.str();
+
+}
+
+void ObjBenchmark::generateModel(std::string const& path)
+{
+
+    // A wavy grid of quads, every vertex shared by four faces like a real closed mesh
+    uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(m_settings.faceCount)))) + 1;
+
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to create benchmark model " + path);
+    }
+
+    file << std::fixed << std::setprecision(6);
+
+    for (uint32_t z = 0; z < side; z++)
+    {
+        for (uint32_t x = 0; x < side; x++)
+        {
+            float height = std::sin(x * 0.1f) * std::cos(z * 0.1f);
+            file << "v " << x * 0.01f << ' ' << height << ' ' << z * 0.01f << '\n';
+            file << "vt " << x / float(side - 1) << ' ' << z / float(side - 1) << '\n';
+            file << "vn 0.000000 1.000000 0.000000\n";
+        }
+    }
+
+    uint32_t faces = 0;
+    for (uint32_t z = 0; z + 1 < side && faces < m_settings.faceCount; z++)
+    {
+        for (uint32_t x = 0; x + 1 < side && faces < m_settings.faceCount; x++, faces++)
+        {
+            uint32_t corner = z * side + x + 1;
+            uint32_t quad[4] = { corner, corner + 1, corner + side + 1, corner + side };
+            file << 'f';
+            for (uint32_t index : quad) file << ' ' << index << '/' << index << '/' << index;
+            file << '\n';
+        }
+    }
+
+}
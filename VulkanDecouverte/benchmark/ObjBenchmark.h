@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Times the OBJ loading on one big model: the parallel ObjParser against the line by
+// line loader it replaced, kept here as the reference. No device is created, it can
+// run on any machine.
+class ObjBenchmark
+{
+public:
+    struct Settings
+    {
+        // Model to load, generated as a grid of quads with faceCount faces when empty
+        std::string objPath;
+        uint32_t faceCount = 2000000;
+        uint32_t runs = 5;
+        std::string outputPath = "obj_benchmark.json";
+
+        // Reads "--obj path --faces N --runs N --output path"
+        static Settings FromCommandLine(std::string const& commandLine);
+    };
+
+    ObjBenchmark(Settings const& settings);
+
+    void run();
+    void writeReport();
+
+private:
+    Settings m_settings;
+    size_t m_fileSize = 0;
+
+    std::vector<double> m_legacyTimes;
+    std::vector<double> m_parallelTimes;
+    size_t m_vertexCount = 0;
+    size_t m_indexCount = 0;
+    // Both loaders gave the same vertices and indices
+    bool m_identical = true;
+
+    void generateModel(std::string const& path);
+};
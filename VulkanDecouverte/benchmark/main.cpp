@@ -0,0 +1,64 @@
+#include <sstream>
+#include <string>
+
+#include "../framework.h"
+
+#include "../Application.h"
+#include "../Profiler.h"
+#include "FrameBenchmark.h"
+#include "ObjBenchmark.h"
+
+// Entry point of VulkanBenchmark: the headless frame benchmark by default, the OBJ
+// loading one with "--obj-benchmark". No window is ever created.
+int main(int argc, char** argv)
+{
+
+    std::string commandLine;
+    for (int i = 1; i < argc; i++) {
+        commandLine += (i > 1 ? " " : "") + std::string(argv[i]);
+    }
+
+    // "--trace file.json" captures a Chrome/Perfetto trace of the whole run
+    size_t traceArgument = commandLine.find("--trace");
+    if (traceArgument != std::string::npos)
+    {
+        std::istringstream arguments(commandLine.substr(traceArgument + std::string("--trace").size()));
+        std::string tracePath = "trace.json";
+        arguments >> tracePath;
+
+        Profiler::Start(tracePath);
+        Profiler::SetThreadName("Main");
+    }
+
+    try
+    {
+        // Parses OBJ files only, no device is created
+        if (commandLine.find("--obj-benchmark") != std::string::npos)
+        {
+            ObjBenchmark benchmark(ObjBenchmark::Settings::FromCommandLine(commandLine));
+            benchmark.run();
+            benchmark.writeReport();
+        }
+        else
+        {
+            Application::getInstance()->Initialize("Benchmark", true);
+
+            FrameBenchmark benchmark(FrameBenchmark::Settings::FromCommandLine(commandLine));
+            benchmark.run();
+            benchmark.writeReport();
+        }
+    }
+    catch (std::exception const& exception)
+    {
+        std::cout << exception.what() << std::endl;
+
+        Profiler::Stop();
+
+        return 1;
+    }
+
+    Profiler::Stop();
+
+    return 0;
+
+}
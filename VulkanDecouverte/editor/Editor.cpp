@@ -1,6 +1,8 @@
 ﻿#include "Editor.h"
 
 #include "../GeometryFactory.h"
+#include "../GpuProfiler.h"
+#include "../Profiler.h"
 #include "../Mesh.h"
 #include "../RenderObject.h"
 #include "../Shader.h"
@@ -14,16 +16,14 @@ Editor::Editor(GuiHandler* guiHandler) : RenderWindow("SVE", 800, 800)
         
     m_mainWindowContext = guiHandler->inject(this);
 
-    Shader sFragment("frag.spv", Shader::FRAGMENT);
-    Shader sVertex("vert.spv", Shader::VERTEX);
-    
-    m_renderPipeline = new RenderPipeline({ &sFragment, &sVertex}, *this);
+    // Compiled by the workers, the window shows up without waiting for the driver
+    m_renderPipeline = &getPipelineRegistry().getAsync(getPipelineDescription());
     
     m_nodeEditor = new NodeEditor(guiHandler);
     m_guiHandler = guiHandler;
 
-    m_mesh = new Mesh(*this, GeometryFactory::GetPrimitive(Primitive::CUBE));
-    m_testObject = new RenderObject(m_mesh);
+    m_mesh = getMeshCache().loadPrimitive(Primitive::CUBE);
+    m_testObject = new RenderObject(m_mesh.get(), m_transforms);
 
     m_inspectorWindow.setInspectedObject(m_testObject);
 
@@ -34,13 +34,18 @@ Editor::Editor(GuiHandler* guiHandler) : RenderWindow("SVE", 800, 800)
 
 Editor::~Editor()
 {
-    delete m_mesh;
-    delete m_renderPipeline;
+    delete m_testObject;
     delete m_nodeEditor;
 }
 
 void Editor::draw()
 {
+
+    PROFILE_FUNCTION();
+
+    for (std::string const& shader : m_shaderWatcher.poll()) {
+        getPipelineRegistry().reload(shader);
+    }
     
     update();
     
@@ -174,13 +179,21 @@ void Editor::draw()
     }
 
     m_inspectorWindow.drawUI(dockspace_id);
+    m_profilerWindow.drawUI(getGpuProfiler(), getDrawStats());
 
     ImGui::Render();
     ImDrawData* draw_data = ImGui::GetDrawData();
     
+    // ImGui gets a secondary buffer of its own
+    uint32_t imguiScope = beginPassScope("ImGui");
     ImGui_ImplVulkan_RenderDrawData(draw_data, getCommandBuffer());
+    endPassScope(imguiScope);
+    flushCommands();
 
+    uint32_t objectsScope = beginPassScope("Objects");
     drawObject(*m_renderPipeline, *m_testObject);
+    flushDraws();
+    endPassScope(objectsScope);
 
     display();
 
@@ -1,10 +1,13 @@
 ﻿#pragma once
 
 #include "InspectorWindow.h"
+#include "ProfilerWindow.h"
 #include "../GuiHandler.h"
+#include "../MeshCache.h"
 #include "../RenderWindow.h"
+#include "../ShaderWatcher.h"
+#include "../TransformStore.h"
 
-class Mesh;
 struct NodeEditor;
 
 class Editor final : public RenderWindow
@@ -17,11 +20,17 @@ public:
 
 private:
     InspectorWindow m_inspectorWindow;
+    ProfilerWindow m_profilerWindow;
+    TransformStore m_transforms;
+    // Saved shaders are recompiled and their pipelines swapped without restarting
+    ShaderWatcher m_shaderWatcher;
     RenderObject* m_testObject;
-    Mesh* m_mesh;
+    // Released after the test object, before the context and its mesh cache go away
+    MeshHandle m_mesh;
 
     VkDescriptorSet DS[2];
     
+    // Owned by the pipeline registry of the context
     RenderPipeline* m_renderPipeline;
     NodeEditor*     m_nodeEditor;
 
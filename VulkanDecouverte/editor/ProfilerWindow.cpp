@@ -0,0 +1,83 @@
+#include "ProfilerWindow.h"
+
+#include "../Application.h"
+#include "../GpuProfiler.h"
+
+ProfilerWindow::ProfilerWindow()
+{
+}
+
+ProfilerWindow::~ProfilerWindow()
+{
+}
+
+void ProfilerWindow::drawUI(GpuProfiler const& profiler, RenderQueue::Stats const& drawStats)
+{
+
+    ImGui::Begin("Profiler");
+
+    double cpuTime = profiler.getCpuFrameTime();
+    double gpuTime = profiler.getGpuFrameTime();
+
+    ImGui::Text("CPU frame : %.3f ms", cpuTime);
+    ImGui::Text("GPU frame : %.3f ms", gpuTime);
+
+    if (!profiler.isSupported())
+    {
+        ImGui::Text("Timestamp queries are not supported by this device");
+    }
+    else
+    {
+        ImGui::Text(gpuTime > cpuTime ? "GPU bound" : "CPU bound");
+    }
+
+    if (ImGui::BeginTable("Scopes", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+    {
+        ImGui::TableSetupColumn("Scope");
+        ImGui::TableSetupColumn("CPU (ms)");
+        ImGui::TableSetupColumn("GPU (ms)");
+        ImGui::TableHeadersRow();
+
+        for (GpuProfiler::ScopeResult const& scope : profiler.getResults())
+        {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Indent((float)scope.depth * 10.0f + 1.0f);
+            ImGui::TextUnformatted(scope.name.c_str());
+            ImGui::Unindent((float)scope.depth * 10.0f + 1.0f);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", scope.cpuTime);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", scope.gpuTime);
+        }
+
+        ImGui::EndTable();
+    }
+
+    ImGui::Text("Draws : %u packets, %u draw calls, %u binds skipped",
+        drawStats.packets, drawStats.drawCalls, drawStats.bindsElided);
+    ImGui::Text("Culling : %u visible, %u culled", drawStats.packets, drawStats.culled);
+    if (drawStats.pipelineNotReady > 0) {
+        ImGui::Text("Compiling : %u objects waiting for their pipeline", drawStats.pipelineNotReady);
+    }
+
+    if (ImGui::CollapsingHeader("Device memory"))
+    {
+        std::vector<MemoryAllocator::HeapStats> heaps = Application::getInstance()->getAllocator().getHeapStats();
+
+        for (size_t heap = 0; heap < heaps.size(); heap++)
+        {
+            MemoryAllocator::HeapStats const& stats = heaps[heap];
+            if (stats.reserved == 0) continue;
+
+            ImGui::Text("Heap %d : %.2f / %.2f MB (%u blocks, %u dedicated, %u allocations)", (int)heap,
+                stats.used / (1024.0 * 1024.0), stats.reserved / (1024.0 * 1024.0),
+                stats.blockCount, stats.dedicatedCount, stats.allocationCount);
+            ImGui::Text("    %u free ranges, largest %.2f MB, fragmentation %.2f", stats.freeRangeCount,
+                stats.largestFreeRange / (1024.0 * 1024.0), stats.fragmentation);
+        }
+    }
+
+    ImGui::End();
+
+}
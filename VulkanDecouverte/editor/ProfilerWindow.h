@@ -0,0 +1,16 @@
+#pragma once
+
+#include "../framework.h"
+
+#include "../RenderQueue.h"
+
+class GpuProfiler;
+
+class ProfilerWindow
+{
+public:
+    ProfilerWindow();
+    ~ProfilerWindow();
+
+    void drawUI(GpuProfiler const& profiler, RenderQueue::Stats const& drawStats);
+};
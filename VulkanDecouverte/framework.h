@@ -10,14 +10,22 @@
 
 #include "libs/nodeflow/include/ImNodeFlow.h"
 
+#ifdef _WIN32
 #define VK_USE_PLATFORM_WIN32_KHR
+#endif
+// Builds without a window system (CI agents) only have the headless targets, see CMakeLists.txt
+#ifdef VD_HEADLESS_ONLY
+#include <vulkan/vulkan.h>
+#else
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
+#endif
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 using namespace glm;
 
@@ -1,7 +1,9 @@
-#define STB_IMAGE_IMPLEMENTATION
-#include "libs/stb_image.h"
+#include <sstream>
+#include <string>
 
+#ifdef _WIN32
 #include <Windows.h>
+#endif
 
 #include "framework.h"
 
@@ -9,15 +11,30 @@
 
 #include "RenderWindow.h"
 #include "GuiHandler.h"
+#include "JobSystem.h"
 #include "Mesh.h"
+#include "Profiler.h"
 #include "RenderObject.h"
 #include "RenderPipeline.h"
 #include "Shader.h"
 #include "editor/Editor.h"
 
-int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR lpCmdLine, int nCmdShow)
+// Arguments after the executable name, separated by spaces, on every platform
+static int run(std::string const& commandLine)
 {
 
+    // "--trace file.json" captures a Chrome/Perfetto trace of the whole session
+    size_t traceArgument = commandLine.find("--trace");
+    if (traceArgument != std::string::npos)
+    {
+        std::istringstream arguments(commandLine.substr(traceArgument + std::string("--trace").size()));
+        std::string tracePath = "trace.json";
+        arguments >> tracePath;
+
+        Profiler::Start(tracePath);
+        Profiler::SetThreadName("Main");
+    }
+
     // Call it to sync this window with the application
     Application::getInstance()->Initialize("Application");
     
@@ -29,13 +46,37 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR lpCmdLine,
     {
         
         glfwPollEvents();
+        Application::getInstance()->getJobSystem().runMainThreadJobs();
         
         editor.draw();
         
     }
 
     vkDeviceWaitIdle(Application::getInstance()->getDevice());
+
+    Profiler::Stop();
     
     return 0;
-    
+
+}
+
+#ifdef _WIN32
+int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR lpCmdLine, int nCmdShow)
+{
+
+    return run(lpCmdLine != nullptr ? lpCmdLine : "");
+
+}
+#else
+int main(int argc, char** argv)
+{
+
+    std::string commandLine;
+    for (int i = 1; i < argc; i++) {
+        commandLine += (i > 1 ? " " : "") + std::string(argv[i]);
+    }
+
+    return run(commandLine);
+
 }
+#endif
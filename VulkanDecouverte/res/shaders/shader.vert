@@ -5,9 +5,10 @@ layout(binding = 0) uniform UniformBufferObject {
     mat4 proj;
 } globalBuffer;
 
-layout (binding = 1) uniform UboInstance {
-    mat4 model;
-} uboInstance;
+// Model matrices of every object drawn this frame, the instance index picks ours
+layout(std140, binding = 1) readonly buffer ObjectBuffer {
+    mat4 models[];
+} objectBuffer;
 
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 normal;
@@ -17,7 +18,7 @@ layout(location = 0) out vec4 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
 
 void main() {
-    gl_Position = globalBuffer.proj * globalBuffer.view * uboInstance.model * vec4(position, 1.0);
+    gl_Position = globalBuffer.proj * globalBuffer.view * objectBuffer.models[gl_InstanceIndex] * vec4(position, 1.0);
     fragColor = vec4(normal.x, normal.y, normal.z, 255.0f);
     fragTexCoord = texCoords;
 }
\ No newline at end of file